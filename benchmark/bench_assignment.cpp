@@ -0,0 +1,61 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../game_cpp/goal_assignment.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	// No update budget here, the cases measure whole auctions
+	constexpr std::size_t UNLIMITED = ~std::size_t(0);
+
+	struct AssignmentCase
+	{
+		std::size_t aircraft_count;
+		std::size_t goal_count;
+	};
+
+	void run_assignment(benchmark::Context & context)
+	{
+		for (const AssignmentCase & scale : { AssignmentCase{ 500, 1 }, AssignmentCase{ 500, 8 }, AssignmentCase{ 5000, 16 }, AssignmentCase{ 50000, 64 } }) {
+			std::mt19937 random(3);
+			std::uniform_real_distribution<float> coordinate(-4.f, 4.f);
+
+			GoalAssignment assignment;
+			assignment.init(scale.goal_count, scale.aircraft_count);
+			std::vector<Vector2> goals(scale.goal_count);
+			for (std::size_t i = 0; i < scale.goal_count; ++i) {
+				goals[i] = Vector2(coordinate(random), coordinate(random));
+				assignment.place_goal(i, goals[i]);
+			}
+
+			std::vector<std::uint32_t> bidders;
+			for (std::size_t i = 0; i + 1 < scale.aircraft_count; ++i) {
+				bidders.push_back(assignment.add(Vector2(coordinate(random), coordinate(random))));
+			}
+			assignment.solve(UNLIMITED);
+
+			const std::string suffix = std::to_string(scale.aircraft_count) + "x" + std::to_string(scale.goal_count);
+
+			// A moved goal restarts the auction for every aircraft
+			std::size_t moved = 0;
+			context.measure("assignment/restart/" + suffix, static_cast<double>(scale.aircraft_count), [&] {
+				assignment.place_goal(moved, goals[moved]);
+				moved = (moved + 1) % scale.goal_count;
+				benchmark::do_not_optimize(assignment.solve(UNLIMITED));
+			});
+
+			// An aircraft takes off into the solved assignment and returns
+			const Vector2 position(coordinate(random), coordinate(random));
+			context.measure("assignment/add_remove/" + suffix, 1.0, [&] {
+				std::uint32_t bidder = assignment.add(position);
+				benchmark::do_not_optimize(assignment.solve(UNLIMITED));
+				assignment.remove(bidder);
+			});
+		}
+	}
+}
+
+BENCHMARK_SUITE("assignment", run_assignment);
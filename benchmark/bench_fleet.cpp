@@ -0,0 +1,47 @@
+#include <string>
+
+#include "../framework/memory.hpp"
+#include "../framework/scene.hpp"
+#include "../game_cpp/carrier_pool.hpp"
+#include "../game_cpp/params.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr float DT = 1.f / 60.f;
+
+	// Time after the launch, when all aircrafts have taken off and patrol
+	constexpr float WARMUP_TIME = params::aircraft::Fighter::TAKEOFF_TIME + 1.f;
+
+	// Updates of a case are bounded, so the aircrafts don't return and land during the measurement
+	constexpr std::size_t MAX_UPDATES = 200;
+
+	void run_fleet(benchmark::Context & context)
+	{
+		const Vector2 goal(2.f, 1.f);
+		for (std::size_t aircraft_count : { 5, 500, 50000 }) {
+			// Every carrier launches its whole capacity
+			const std::size_t carrier_count = aircraft_count / params::ship::AIRCRAFT_CAPACITY;
+			CarrierPool carriers(carrier_count);
+			carriers.init(carrier_count);
+			carriers.place_goal(0, goal);
+			for (std::size_t i = 0; i < params::ship::AIRCRAFT_CAPACITY; ++i) {
+				carriers.launch();
+			}
+			// Updates take their scratch arrays from the frame memory, the scope releases them
+			auto update = [&] {
+				memory::FrameScope frame_scope;
+				carriers.update(DT);
+			};
+			for (float time = 0.f; time < WARMUP_TIME; time += DT) {
+				update();
+			}
+
+			context.measure("fleet/update/" + std::to_string(aircraft_count), static_cast<double>(aircraft_count), update, MAX_UPDATES);
+			carriers.deinit();
+		}
+	}
+}
+
+BENCHMARK_SUITE("fleet", run_fleet);
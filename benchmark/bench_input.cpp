@@ -0,0 +1,58 @@
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+
+#include "../framework/input.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr int BATCH_SIZE = 64;
+	constexpr int THREADED_EVENT_COUNT = 1 << 16;
+
+	void run_input(benchmark::Context & context)
+	{
+		// A burst of window messages, queued and drained by the same thread
+		context.measure("input/push_pop", BATCH_SIZE, [] {
+			for (int i = 0; i < BATCH_SIZE; ++i) {
+				input::pushKeyPressed(i & 3);
+			}
+			input::Event event;
+			while (input::pop(&event)) {
+				benchmark::do_not_optimize(event);
+			}
+		});
+
+		// Producer and consumer on their own threads, the consumer checks that no event is lost or reordered
+		// Both sides yield while they wait, so the case also runs on a single core
+		context.measure("input/threaded", THREADED_EVENT_COUNT, [] {
+			std::thread producer([] {
+				for (int i = 0; i < THREADED_EVENT_COUNT;) {
+					if (input::pushMouseClicked(static_cast<float>(i), 0.f, true)) {
+						++i;
+					}
+					else {
+						std::this_thread::yield();
+					}
+				}
+			});
+
+			input::Event event;
+			for (int i = 0; i < THREADED_EVENT_COUNT;) {
+				if (!input::pop(&event)) {
+					std::this_thread::yield();
+					continue;
+				}
+				if (event.x != static_cast<float>(i)) {
+					std::fprintf(stderr, "input: event %d arrived as %g\n", i, event.x);
+					std::abort();
+				}
+				++i;
+			}
+			producer.join();
+		});
+	}
+}
+
+BENCHMARK_SUITE("input", run_input);
@@ -0,0 +1,89 @@
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../framework/scene.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr float DT = 1.f / 60.f;
+	constexpr std::size_t CHURN_COUNT = 256;
+	constexpr std::size_t PUBLISH_MESH_COUNT = 4096;
+
+	// Trails are emitted by the fleet in the game, here directly, they need a few seconds to fill up
+	constexpr float WARMUP_TIME = 2.f;
+	constexpr int TRAIL_STEPS = 6;
+
+	void run_scene(benchmark::Context & context)
+	{
+		std::vector<scene::Mesh *> meshes(CHURN_COUNT);
+		context.measure("scene/mesh_churn", CHURN_COUNT, [&] {
+			for (scene::Mesh *& mesh : meshes) {
+				mesh = scene::createAircraftMesh();
+				scene::placeMesh(mesh, 0.f, 0.f, 0.f);
+			}
+			// Scattered removal order, most removals move the last mesh of the pool into the freed place
+			for (std::size_t i = 0; i < CHURN_COUNT; ++i) {
+				scene::destroyMesh(meshes[(i * 7) % CHURN_COUNT]);
+			}
+		});
+
+		// A step long enough to refill the whole sea pool of 1024 particles spawns them as one batch
+		constexpr int SEA_POOL_CAPACITY = 1024;
+		constexpr float TIME_BETWEEN_SEA_PARTICLES = 0.02f;
+		context.measure("scene/spawn_sea", SEA_POOL_CAPACITY, [] { scene::update(SEA_POOL_CAPACITY * TIME_BETWEEN_SEA_PARTICLES); });
+
+		// Particle counts follow the number of emitting aircrafts, about 8 trail particles each
+		for (std::size_t emitter_count : { 0, 128, 1024, 4096 }) {
+			std::vector<float> emitter_x(emitter_count);
+			std::vector<float> emitter_y(emitter_count, 0.f);
+			for (std::size_t i = 0; i < emitter_count; ++i) {
+				emitter_x[i] = 0.001f * i;
+			}
+			// Every aircraft emits once in TRAIL_STEPS steps, a slice of them in each step
+			int step = 0;
+			auto update = [&] {
+				const std::size_t first = emitter_count * (step % TRAIL_STEPS) / TRAIL_STEPS;
+				const std::size_t last = emitter_count * (step % TRAIL_STEPS + 1) / TRAIL_STEPS;
+				scene::updateParticles(DT);
+				scene::emitTrails(emitter_x.data() + first, emitter_y.data() + first, static_cast<int>(last - first));
+				scene::update(DT);
+				++step;
+			};
+			while (step * DT < WARMUP_TIME) {
+				update();
+			}
+
+			// A steady step: the oldest particles expire, the emitted ones replace them and the count stays the same
+			const int particle_count = scene::getParticleCount();
+			context.measure("scene/update_particles/" + std::to_string(emitter_count), particle_count > 0 ? particle_count : 1, update);
+			context.set_counter(particle_count);
+		}
+
+		// Publish over the whole world, a zoomed in view most meshes are culled from,
+		// and a zoomed out one, which draws the aircrafts as points
+		std::vector<scene::Mesh *> aircrafts(PUBLISH_MESH_COUNT);
+		std::mt19937 random(7);
+		std::uniform_real_distribution<float> unit(0.f, 1.f);
+		for (scene::Mesh *& mesh : aircrafts) {
+			float x = unit(random);
+			float y = unit(random);
+			scene::unitToWorld(&x, &y);
+			mesh = scene::createAircraftMesh();
+			scene::placeMesh(mesh, x, y, 6.f * unit(random));
+		}
+		const struct { const char * name; float zoom; } views[] = { { "world", 1.f }, { "zoom_in", 4.f }, { "points", 0.25f } };
+		for (const auto & view : views) {
+			scene::setCamera(0.f, 0.f, view.zoom);
+			context.measure(std::string("scene/publish/") + view.name, PUBLISH_MESH_COUNT, [] { scene::publish(1.f); });
+		}
+		scene::setCamera(0.f, 0.f, 1.f);
+		for (scene::Mesh * mesh : aircrafts) {
+			scene::destroyMesh(mesh);
+		}
+	}
+}
+
+BENCHMARK_SUITE("scene", run_scene);
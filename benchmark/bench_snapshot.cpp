@@ -0,0 +1,53 @@
+#include <string>
+
+#include "../framework/memory.hpp"
+#include "../game_cpp/carrier_pool.hpp"
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/snapshot.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr float DT = 1.f / 60.f;
+
+	// All aircrafts patrol, some carriers wait for refills: the state a scenario would start from
+	constexpr float WARMUP_TIME = params::aircraft::Fighter::TAKEOFF_TIME + 1.f;
+
+	void run_snapshot(benchmark::Context & context)
+	{
+		for (std::size_t aircraft_count : { 500, 50000 }) {
+			const std::size_t carrier_count = aircraft_count / params::ship::AIRCRAFT_CAPACITY;
+			CarrierPool carriers(carrier_count);
+			carriers.init(carrier_count, AIRCRAFT_MIXED, 16);
+			for (std::size_t i = 0; i < params::ship::AIRCRAFT_CAPACITY; ++i) {
+				carriers.launch();
+			}
+			for (float time = 0.f; time < WARMUP_TIME; time += DT) {
+				memory::FrameScope frame_scope;
+				carriers.update(DT);
+			}
+
+			const std::string suffix = std::to_string(aircraft_count);
+			std::size_t snapshot_size = 0;
+			context.measure("snapshot/save/" + suffix, static_cast<double>(aircraft_count), [&] {
+				SnapshotWriter snapshot;
+				carriers.save(snapshot);
+				snapshot_size = snapshot.get_data().size();
+			});
+			context.set_counter(static_cast<double>(snapshot_size));
+
+			// Restore replaces the whole pool, meshes included, the way a scenario starts
+			SnapshotWriter saved;
+			carriers.save(saved);
+			const std::vector<char> & data = saved.get_data();
+			context.measure("snapshot/restore/" + suffix, static_cast<double>(aircraft_count), [&] {
+				SnapshotReader snapshot(data.data(), data.size());
+				benchmark::do_not_optimize(carriers.restore(snapshot));
+			});
+			carriers.deinit();
+		}
+	}
+}
+
+BENCHMARK_SUITE("snapshot", run_snapshot);
@@ -0,0 +1,167 @@
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../game_cpp/aircraft_fleet.hpp"
+#include "../game_cpp/params.hpp"
+#include "../game_cpp/steering_kernels.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	typedef params::aircraft::Fighter Traits;
+
+	constexpr std::size_t AIRCRAFT_COUNT = 4096;
+	constexpr float DT = 1.f / 60.f;
+
+	/*
+	 * Steering input of a batch of aircrafts in flight: patrolling aircrafts steer to far orbit points
+	 * at full speed, landing ones are inside the landing radius and take the slowdown branch
+	 */
+	struct SteeringData
+	{
+		std::vector<float> destination_x, destination_y, steering_mask, goal_x, goal_y;
+		std::vector<float> angle, heading_x, heading_y, velocity_x, velocity_y, position_x, position_y;
+
+		SteeringData(float min_distance, float max_distance) :
+			destination_x(AIRCRAFT_COUNT), destination_y(AIRCRAFT_COUNT), steering_mask(AIRCRAFT_COUNT, 1.f), goal_x(AIRCRAFT_COUNT), goal_y(AIRCRAFT_COUNT),
+			angle(AIRCRAFT_COUNT), heading_x(AIRCRAFT_COUNT), heading_y(AIRCRAFT_COUNT), velocity_x(AIRCRAFT_COUNT), velocity_y(AIRCRAFT_COUNT),
+			position_x(AIRCRAFT_COUNT), position_y(AIRCRAFT_COUNT)
+		{
+			std::mt19937 random(1);
+			std::uniform_real_distribution<float> direction(-3.14f, 3.14f);
+			std::uniform_real_distribution<float> distance(min_distance, max_distance);
+			for (std::size_t i = 0; i < AIRCRAFT_COUNT; ++i) {
+				Vector2 destination = distance(random) * Vector2(1.f, 0.f).get_rotated(direction(random));
+				destination_x[i] = destination.x;
+				destination_y[i] = destination.y;
+
+				angle[i] = direction(random);
+				heading_x[i] = std::cos(angle[i]);
+				heading_y[i] = std::sin(angle[i]);
+				Vector2 velocity = Traits::LINEAR_SPEED * Vector2(heading_x[i], heading_y[i]);
+				velocity_x[i] = velocity.x;
+				velocity_y[i] = velocity.y;
+			}
+		}
+
+		SteeringBatch get_batch()
+		{
+			SteeringBatch batch;
+			batch.count = AIRCRAFT_COUNT;
+			batch.destination_x = destination_x.data();
+			batch.destination_y = destination_y.data();
+			batch.steering_mask = steering_mask.data();
+			batch.goal_x = goal_x.data();
+			batch.goal_y = goal_y.data();
+			batch.angle = angle.data();
+			batch.heading_x = heading_x.data();
+			batch.heading_y = heading_y.data();
+			batch.velocity_x = velocity_x.data();
+			batch.velocity_y = velocity_y.data();
+			batch.position_x = position_x.data();
+			batch.position_y = position_y.data();
+			return batch;
+		}
+	};
+
+	/*
+	 * Patrolling aircrafts on a steady orbit: every call turns them around the goal at the origin by the same angle,
+	 * the exact orbit kernel and the cached path take the same input. The counter of the cached case is
+	 * the fraction of destinations, which took the incremental rotation step
+	 */
+	void run_steady_orbit(benchmark::Context & context, const SteeringParams & steering)
+	{
+		const float turn = Traits::ANGULAR_SPEED * DT;
+		const float turn_cos = std::cos(turn);
+		const float turn_sin = std::sin(turn);
+
+		SteeringData orbit(0.5f * Traits::TARGET_RADIUS, 4.f * Traits::TARGET_RADIUS);
+		orbit.position_x = orbit.destination_x;
+		orbit.position_y = orbit.destination_y;
+		SteeringBatch batch = orbit.get_batch();
+		auto advance = [&] {
+			for (std::size_t i = 0; i < AIRCRAFT_COUNT; ++i) {
+				const float x = orbit.position_x[i];
+				const float y = orbit.position_y[i];
+				orbit.position_x[i] = turn_cos * x - turn_sin * y;
+				orbit.position_y[i] = turn_sin * x + turn_cos * y;
+			}
+		};
+
+		const SteeringKernels & kernels = get_steering_kernels();
+		context.measure(std::string("steering/steady_orbit/") + kernels.name, AIRCRAFT_COUNT, [&] {
+			advance();
+			kernels.orbit(steering, batch, orbit.destination_x.data(), orbit.destination_y.data());
+		});
+
+		std::vector<float> normal_x(AIRCRAFT_COUNT), normal_y(AIRCRAFT_COUNT), step_cos(AIRCRAFT_COUNT), step_sin(AIRCRAFT_COUNT);
+		std::vector<float> goal_x(AIRCRAFT_COUNT), goal_y(AIRCRAFT_COUNT);
+		std::vector<std::uint8_t> states(AIRCRAFT_COUNT, ORBIT_CACHE_COLD);
+		const OrbitCache cache = { normal_x.data(), normal_y.data(), step_cos.data(), step_sin.data(), goal_x.data(), goal_y.data(), states.data() };
+		std::size_t cached_count = 0;
+		std::size_t call_count = 0;
+		context.measure("steering/steady_orbit/cached", AIRCRAFT_COUNT, [&] {
+			advance();
+			cached_count += orbit_cached(steering, batch, cache, orbit.destination_x.data(), orbit.destination_y.data());
+			++call_count;
+		});
+		// A filtered out case isn't called
+		if (call_count > 0) {
+			context.set_counter(static_cast<double>(cached_count) / static_cast<double>(call_count * AIRCRAFT_COUNT));
+		}
+	}
+
+	void run_steering(benchmark::Context & context)
+	{
+		constexpr float LANDING_RADIUS = AircraftFleet<Traits>::LANDING_RADIUS;
+
+		SteeringParams steering;
+		steering.linear_speed = Traits::LINEAR_SPEED;
+		steering.landing_radius = LANDING_RADIUS;
+		steering.landing_speed = Traits::LANDING_SPEED;
+		steering.max_rotation = Traits::ANGULAR_SPEED * DT;
+		steering.acceleration = Traits::LINEAR_ACCELERATION * DT;
+		steering.rotation_cos = std::cos(steering.max_rotation);
+		steering.rotation_sin = std::sin(steering.max_rotation);
+		steering.dt = DT;
+		steering.target_radius = Traits::TARGET_RADIUS;
+
+		const std::string best = get_steering_kernels().name;
+		for (const char * name : { "scalar", "sse", "avx", "neon" }) {
+			if (!select_steering_kernels(name)) {
+				continue;
+			}
+
+			const SteeringKernels & kernels = get_steering_kernels();
+			const std::string prefix = std::string("steering/") + name;
+
+			// Patrolling aircrafts around the goal at the origin, their random destinations are taken as positions
+			SteeringData orbit(0.5f * Traits::TARGET_RADIUS, 4.f * Traits::TARGET_RADIUS);
+			orbit.position_x = orbit.destination_x;
+			orbit.position_y = orbit.destination_y;
+			SteeringBatch orbit_batch = orbit.get_batch();
+			context.measure(prefix + "/orbit", AIRCRAFT_COUNT, [&] {
+				kernels.orbit(steering, orbit_batch, orbit.destination_x.data(), orbit.destination_y.data());
+			});
+
+			SteeringData patrol(2.f * LANDING_RADIUS, 4.f * LANDING_RADIUS);
+			SteeringBatch patrol_batch = patrol.get_batch();
+			context.measure(prefix + "/steer_patrol", AIRCRAFT_COUNT, [&] { kernels.steer(steering, patrol_batch); });
+
+			SteeringData landing(0.1f, LANDING_RADIUS);
+			SteeringBatch landing_batch = landing.get_batch();
+			context.measure(prefix + "/steer_landing", AIRCRAFT_COUNT, [&] { kernels.steer(steering, landing_batch); });
+
+			context.measure(prefix + "/integrate", AIRCRAFT_COUNT, [&] { kernels.integrate(steering, patrol_batch); });
+		}
+		select_steering_kernels(best.c_str());
+
+		run_steady_orbit(context, steering);
+	}
+}
+
+BENCHMARK_SUITE("steering", run_steering);
@@ -0,0 +1,44 @@
+#include <thread>
+
+#include "../framework/telemetry.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr int BATCH_SIZE = 1024;
+
+	const telemetry::Counter s_counter("benchmark.counter");
+	const telemetry::Histogram s_histogram("benchmark.histogram");
+
+	void run_telemetry(benchmark::Context & context)
+	{
+		context.measure("telemetry/counter_add", BATCH_SIZE, [] {
+			for (int i = 0; i < BATCH_SIZE; ++i) {
+				s_counter.add();
+			}
+		});
+
+		// Values of frame times in nanoseconds, spread over many buckets
+		context.measure("telemetry/histogram_record", BATCH_SIZE, [] {
+			for (int i = 0; i < BATCH_SIZE; ++i) {
+				s_histogram.record(1000 + i * 7919);
+			}
+		});
+
+		// Another thread records at the same time into its own shard
+		context.measure("telemetry/histogram_record_shared", BATCH_SIZE, [] {
+			std::thread other([] {
+				for (int i = 0; i < BATCH_SIZE; ++i) {
+					s_histogram.record(1000 + i * 7919);
+				}
+			});
+			for (int i = 0; i < BATCH_SIZE; ++i) {
+				s_histogram.record(1000 + i * 7919);
+			}
+			other.join();
+		});
+	}
+}
+
+BENCHMARK_SUITE("telemetry", run_telemetry);
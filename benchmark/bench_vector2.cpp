@@ -0,0 +1,52 @@
+#include <random>
+#include <vector>
+
+#include "../game_cpp/vector2.hpp"
+#include "benchmark.hpp"
+
+
+namespace
+{
+	constexpr std::size_t VECTOR_COUNT = 1024;
+
+	void run_vector2(benchmark::Context & context)
+	{
+		std::mt19937 random(1);
+		std::uniform_real_distribution<float> coordinate(-10.f, 10.f);
+		std::uniform_real_distribution<float> angle(-3.14f, 3.14f);
+
+		std::vector<Vector2> lhv, rhv;
+		std::vector<float> angles;
+		for (std::size_t i = 0; i < VECTOR_COUNT; ++i) {
+			lhv.emplace_back(coordinate(random), coordinate(random));
+			rhv.emplace_back(coordinate(random), coordinate(random));
+			angles.push_back(angle(random));
+		}
+
+		context.measure("vector2/get_normalized", VECTOR_COUNT, [&] {
+			for (const Vector2 & vector : lhv) {
+				benchmark::do_not_optimize(vector.get_normalized());
+			}
+		});
+
+		context.measure("vector2/dot", VECTOR_COUNT, [&] {
+			for (std::size_t i = 0; i < VECTOR_COUNT; ++i) {
+				benchmark::do_not_optimize(Vector2::dot(lhv[i], rhv[i]));
+			}
+		});
+
+		context.measure("vector2/angle_rad", VECTOR_COUNT, [&] {
+			for (std::size_t i = 0; i < VECTOR_COUNT; ++i) {
+				benchmark::do_not_optimize(Vector2::angle_rad(lhv[i], rhv[i]));
+			}
+		});
+
+		context.measure("vector2/get_rotated", VECTOR_COUNT, [&] {
+			for (std::size_t i = 0; i < VECTOR_COUNT; ++i) {
+				benchmark::do_not_optimize(lhv[i].get_rotated(angles[i]));
+			}
+		});
+	}
+}
+
+BENCHMARK_SUITE("vector2", run_vector2);
@@ -0,0 +1,69 @@
+#include <algorithm>
+#include <cmath>
+
+#include "benchmark.hpp"
+
+
+namespace benchmark
+{
+	namespace
+	{
+		std::vector<Suite> & get_suite_list()
+		{
+			// Function local, suites register during static initialization of other translation units
+			static std::vector<Suite> suites;
+			return suites;
+		}
+	}
+
+	SuiteRegistration::SuiteRegistration(const char * name, SuiteFunction function)
+	{
+		get_suite_list().push_back(Suite{ name, function });
+	}
+
+	const std::vector<Suite> & get_suites()
+	{
+		return get_suite_list();
+	}
+
+	Context::Context(const char * filter, double min_time, int repetitions) :
+		m_filter(filter ? filter : ""),
+		m_min_time(min_time),
+		m_repetitions(std::max(repetitions, 1))
+	{
+	}
+
+	void Context::set_counter(double value)
+	{
+		if (m_last_selected) {
+			m_results.back().counter = value;
+		}
+	}
+
+	bool Context::is_selected(const std::string & name) const
+	{
+		return m_filter.empty() || name.find(m_filter) != std::string::npos;
+	}
+
+	std::size_t Context::calibrate(double seconds_per_call) const
+	{
+		// Every repetition takes about min_time / repetitions
+		double calls = m_min_time / m_repetitions / std::max(seconds_per_call, 1e-9);
+		return static_cast<std::size_t>(std::max(calls, 1.0));
+	}
+
+	void Context::add_result(const std::string & name, std::size_t iterations, double items_per_call, std::vector<double> & times)
+	{
+		std::sort(times.begin(), times.end());
+		double scale = 1e9 / (iterations * items_per_call);
+
+		Result result;
+		result.name = name;
+		result.iterations = iterations;
+		result.items_per_call = items_per_call;
+		result.median_ns = times[times.size() / 2] * scale;
+		result.min_ns = times.front() * scale;
+		result.counter = 0.0;
+		m_results.push_back(result);
+	}
+}
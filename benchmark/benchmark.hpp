@@ -0,0 +1,127 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+/*
+ * Minimal microbenchmark runner, no external dependencies
+ *
+ * A benchmark suite is a function, which calls Context::measure for every case it covers
+ * Every case is calibrated to run at least min_time, then timed in a few repetitions,
+ * the median repetition is reported. Results are written as JSON, see main.cpp
+ */
+namespace benchmark
+{
+	struct Result
+	{
+		std::string name;
+		std::size_t iterations;		// calls of the measured function per repetition
+		double items_per_call;
+		double median_ns;			// per item
+		double min_ns;				// per item
+		double counter;				// case specific value, e.g. alive particles, 0 if not used
+	};
+
+	class Context
+	{
+	public:
+		Context(const char * filter, double min_time, int repetitions);
+
+		// Measures function(), which processes items_per_call items
+		// max_iterations bounds the calls for cases, which change state over time (simulation updates)
+		template <class Function>
+		void measure(const std::string & name, double items_per_call, Function && function, std::size_t max_iterations = 0);
+
+		// Sets the counter of the last measured case, ignored when that case was filtered out
+		void set_counter(double value);
+
+		const std::vector<Result> & get_results() const { return m_results; }
+
+	private:
+		typedef std::chrono::steady_clock Clock;
+
+		bool is_selected(const std::string & name) const;
+		std::size_t calibrate(double seconds_per_call) const;
+		void add_result(const std::string & name, std::size_t iterations, double items_per_call, std::vector<double> & times);
+
+		std::string m_filter;
+		double m_min_time;
+		int m_repetitions;
+		std::vector<Result> m_results;
+		bool m_last_selected = false;	// whether the last measure call ran its case
+	};
+
+	typedef void (*SuiteFunction)(Context & context);
+
+	// Suites register themselves from static initializers, see BENCHMARK_SUITE
+	struct SuiteRegistration
+	{
+		SuiteRegistration(const char * name, SuiteFunction function);
+	};
+
+	struct Suite
+	{
+		const char * name;
+		SuiteFunction function;
+	};
+
+	const std::vector<Suite> & get_suites();
+
+	// Keeps the compiler from removing the computation of value
+	template <class T>
+	inline void do_not_optimize(const T & value)
+	{
+#if defined(__GNUC__)
+		asm volatile("" : : "r,m"(value) : "memory");
+#else
+		static volatile char sink;
+		sink = *reinterpret_cast<const volatile char *>(&value);
+#endif
+	}
+
+	template <class Function>
+	void Context::measure(const std::string & name, double items_per_call, Function && function, std::size_t max_iterations)
+	{
+		m_last_selected = is_selected(name);
+		if (!m_last_selected) {
+			return;
+		}
+
+		// Calibration: grow the number of calls until a run takes a noticeable time
+		std::size_t iterations = 1;
+		for (;;) {
+			Clock::time_point start = Clock::now();
+			for (std::size_t i = 0; i < iterations; ++i) {
+				function();
+			}
+			double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+			if (elapsed >= m_min_time / 10 || (max_iterations > 0 && iterations >= max_iterations)) {
+				iterations = calibrate(elapsed / iterations);
+				break;
+			}
+			iterations *= 10;
+		}
+		if (max_iterations > 0 && iterations > max_iterations) {
+			iterations = max_iterations;
+		}
+
+		std::vector<double> times;
+		for (int repetition = 0; repetition < m_repetitions; ++repetition) {
+			Clock::time_point start = Clock::now();
+			for (std::size_t i = 0; i < iterations; ++i) {
+				function();
+			}
+			times.push_back(std::chrono::duration<double>(Clock::now() - start).count());
+		}
+		add_result(name, iterations, items_per_call, times);
+	}
+}
+
+#define BENCHMARK_CONCAT_IMPL(a, b) a##b
+#define BENCHMARK_CONCAT(a, b) BENCHMARK_CONCAT_IMPL(a, b)
+
+#define BENCHMARK_SUITE(name, function) \
+	static benchmark::SuiteRegistration BENCHMARK_CONCAT(benchmark_suite_, __LINE__)(name, function)
@@ -0,0 +1,87 @@
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "../framework/jobs.hpp"
+#include "../framework/memory.hpp"
+#include "../framework/options.hpp"
+#include "benchmark.hpp"
+
+
+/*
+ * Microbenchmarks of the game and scene hot paths, built by project_make as bin/wots_benchmark
+ *
+ * Options:
+ *	--filter TEXT		run only cases, which name contains TEXT
+ *	--min-time T		seconds per case, 0.5 by default
+ *	--repetitions N		timed repetitions per case, the median is reported, 5 by default
+ *	--output FILE		write JSON results to FILE instead of the standard output
+ *	--threads N			number of job system workers
+ *
+ * A human readable table goes to the standard error output
+ */
+
+namespace
+{
+	// Holds the scratch arrays of the largest fleet case, frame scopes never grow the arena
+	constexpr std::size_t FRAME_ARENA_SIZE = 4 * 1024 * 1024;
+
+	void write_json(FILE * file, const std::vector<benchmark::Result> & results)
+	{
+		std::fprintf(file, "{\n\t\"benchmarks\": [");
+		const char * separator = "\n";
+		for (const benchmark::Result & result : results) {
+			std::fprintf(file, "%s\t\t{ \"name\": \"%s\", \"iterations\": %zu, \"items_per_call\": %g, "
+				"\"median_ns\": %.4f, \"min_ns\": %.4f, \"counter\": %g }",
+				separator, result.name.c_str(), result.iterations, result.items_per_call,
+				result.median_ns, result.min_ns, result.counter);
+			separator = ",\n";
+		}
+		std::fprintf(file, "\n\t]\n}\n");
+	}
+}
+
+int main(int argc, char ** argv)
+{
+	options::parse(argc, argv);
+	jobs::init(options::getInt("threads", jobs::getDefaultWorkerCount()));
+	memory::init(FRAME_ARENA_SIZE);
+
+	benchmark::Context context(options::getString("filter", ""), options::getFloat("min-time", 0.5f),
+		options::getInt("repetitions", 5));
+
+	std::fprintf(stderr, "%-44s %14s %14s %12s\n", "case", "median ns/item", "min ns/item", "counter");
+	std::size_t printed = 0;
+	// Registration order depends on the link order, run suites by name for a stable output
+	std::vector<benchmark::Suite> suites = benchmark::get_suites();
+	std::sort(suites.begin(), suites.end(), [](const benchmark::Suite & lhv, const benchmark::Suite & rhv) {
+		return std::strcmp(lhv.name, rhv.name) < 0;
+	});
+
+	for (const benchmark::Suite & suite : suites) {
+		suite.function(context);
+
+		const std::vector<benchmark::Result> & results = context.get_results();
+		for (; printed < results.size(); ++printed) {
+			const benchmark::Result & result = results[printed];
+			std::fprintf(stderr, "%-44s %14.3f %14.3f %12g\n", result.name.c_str(), result.median_ns, result.min_ns, result.counter);
+		}
+	}
+
+	const char * path = options::getString("output", nullptr);
+	FILE * file = path ? std::fopen(path, "w") : stdout;
+	if (!file) {
+		std::fprintf(stderr, "can't write %s\n", path);
+		memory::deinit();
+		jobs::deinit();
+		return 1;
+	}
+	write_json(file, context.get_results());
+	if (file != stdout) {
+		std::fclose(file);
+	}
+
+	memory::deinit();
+	jobs::deinit();
+	return 0;
+}
@@ -1,11 +1,26 @@
 
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <windows.h>
 #include <windowsx.h>
+#include <mmsystem.h>
 #include <GL/gl.h>
 
 #include "game.hpp"
+#include "glext.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "memory.hpp"
+#include "options.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
 #include "scene.hpp"
+#include "streambuffer.hpp"
+#include "telemetry.hpp"
+#include "timestep.hpp"
 
 
 //-------------------------------------------------------
@@ -18,6 +33,78 @@ namespace
 
 	constexpr int WINDOW_WIDTH = 1024;
 	constexpr int WINDOW_HEIGHT = 768;
+	constexpr char const *WINDOW_TITLE = "World of Tinyships [CLOSED ALPHA]";
+
+	// Mouse wheel zooms around the cursor, the middle button drags the view, Home resets it
+	constexpr float CAMERA_ZOOM_STEP = 1.25f;
+	constexpr float MIN_CAMERA_ZOOM = 0.25f;
+	constexpr float MAX_CAMERA_ZOOM = 8.f;
+
+	bool isPanning = false;
+	float panScreenX = 0.f;
+	float panScreenY = 0.f;
+
+	// The camera as the input asked for it, the scene gets it with the next simulation step
+	// While replaying, the log moves the camera, it is taken from the scene between frames
+	float cameraX = 0.f;
+	float cameraY = 0.f;
+	float cameraZoom = 1.f;
+
+
+	//-------------------------------------------------------
+	// Client area pixels to the [0, 1] screen coordinates of the scene
+	void toScreen( int pixelX, int pixelY, float *x, float *y )
+	{
+		*x = ( float )pixelX / WINDOW_WIDTH;
+		*y = 1.f - ( float )pixelY / WINDOW_HEIGHT;
+	}
+
+
+	//-------------------------------------------------------
+	// Same mapping as scene::screenToWorld, through the requested camera: the world is centered on the origin
+	void screenToWorld( float screenX, float screenY, float *x, float *y )
+	{
+		*x = screenX;
+		*y = screenY;
+		scene::unitToWorld( x, y );
+		*x = cameraX + *x / cameraZoom;
+		*y = cameraY + *y / cameraZoom;
+	}
+
+
+	//-------------------------------------------------------
+	void setCamera( float x, float y, float zoom )
+	{
+		cameraX = x;
+		cameraY = y;
+		cameraZoom = zoom;
+		input::pushCamera( x, y, zoom );
+	}
+
+
+	//-------------------------------------------------------
+	void zoomCamera( float screenX, float screenY, float steps )
+	{
+		float newZoom = std::min( std::max( cameraZoom * std::pow( CAMERA_ZOOM_STEP, steps ), MIN_CAMERA_ZOOM ), MAX_CAMERA_ZOOM );
+
+		// The world point under the cursor stays in place
+		float pointX, pointY;
+		screenToWorld( screenX, screenY, &pointX, &pointY );
+		float scale = cameraZoom / newZoom;
+		setCamera( pointX + ( cameraX - pointX ) * scale, pointY + ( cameraY - pointY ) * scale, newZoom );
+	}
+
+
+	//-------------------------------------------------------
+	void panCamera( float screenX, float screenY )
+	{
+		float fromX, fromY, toX, toY;
+		screenToWorld( panScreenX, panScreenY, &fromX, &fromY );
+		screenToWorld( screenX, screenY, &toX, &toY );
+		panScreenX = screenX;
+		panScreenY = screenY;
+		setCamera( cameraX - ( toX - fromX ), cameraY - ( toY - fromY ), cameraZoom );
+	}
 
 
 	//-------------------------------------------------------
@@ -31,38 +118,72 @@ namespace
 
 			case WM_KEYDOWN:
 				if ( wParam == 'W' || wParam == VK_UP )
-					game::keyPressed( game::KEY_FORWARD );
+					input::pushKeyPressed( game::KEY_FORWARD );
 				if ( wParam == 'S' || wParam == VK_DOWN )
-					game::keyPressed( game::KEY_BACKWARD );
+					input::pushKeyPressed( game::KEY_BACKWARD );
 				if ( wParam == 'A' || wParam == VK_LEFT )
-					game::keyPressed( game::KEY_LEFT );
+					input::pushKeyPressed( game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
-					game::keyPressed( game::KEY_RIGHT );
+					input::pushKeyPressed( game::KEY_RIGHT );
 				if ( wParam == VK_ESCAPE )
 					DestroyWindow( windowHandle );
 				break;
 
 			case WM_KEYUP:
 				if ( wParam == 'W' || wParam == VK_UP )
-					game::keyReleased( game::KEY_FORWARD );
+					input::pushKeyReleased( game::KEY_FORWARD );
 				if ( wParam == 'S' || wParam == VK_DOWN )
-					game::keyReleased( game::KEY_BACKWARD );
+					input::pushKeyReleased( game::KEY_BACKWARD );
 				if ( wParam == 'A' || wParam == VK_LEFT )
-					game::keyReleased( game::KEY_LEFT );
+					input::pushKeyReleased( game::KEY_LEFT );
 				if ( wParam == 'D' || wParam == VK_RIGHT )
-					game::keyReleased( game::KEY_RIGHT );
+					input::pushKeyReleased( game::KEY_RIGHT );
 				if ( wParam == VK_SPACE )
-				{
-					game::deinit();
-					game::init();
-				}
+					input::pushRestart();
+				if ( wParam == VK_F3 )
+					profiler::setEnabled( !profiler::isEnabled() );
+				if ( wParam == VK_HOME )
+					setCamera( 0.f, 0.f, 1.f );
 				break;
 
 			case WM_LBUTTONUP:
 			case WM_RBUTTONUP:
-				game::mouseClicked( ( float )( GET_X_LPARAM( lParam ) ) / WINDOW_WIDTH,
-									1.f - ( float )( GET_Y_LPARAM( lParam ) ) / WINDOW_HEIGHT,
-									message == WM_LBUTTONUP );
+			{
+				float x, y;
+				toScreen( GET_X_LPARAM( lParam ), GET_Y_LPARAM( lParam ), &x, &y );
+				input::pushMouseClicked( x, y, message == WM_LBUTTONUP );
+				break;
+			}
+
+			case WM_MOUSEWHEEL:
+			{
+				// Wheel messages come with screen coordinates
+				POINT cursor = { GET_X_LPARAM( lParam ), GET_Y_LPARAM( lParam ) };
+				ScreenToClient( hwnd, &cursor );
+				float x, y;
+				toScreen( cursor.x, cursor.y, &x, &y );
+				zoomCamera( x, y, ( float )GET_WHEEL_DELTA_WPARAM( wParam ) / WHEEL_DELTA );
+				break;
+			}
+
+			case WM_MBUTTONDOWN:
+				isPanning = true;
+				toScreen( GET_X_LPARAM( lParam ), GET_Y_LPARAM( lParam ), &panScreenX, &panScreenY );
+				SetCapture( hwnd );
+				break;
+
+			case WM_MOUSEMOVE:
+				if ( isPanning )
+				{
+					float x, y;
+					toScreen( GET_X_LPARAM( lParam ), GET_Y_LPARAM( lParam ), &x, &y );
+					panCamera( x, y );
+				}
+				break;
+
+			case WM_MBUTTONUP:
+				isPanning = false;
+				ReleaseCapture();
 				break;
 		}
 		return DefWindowProc( hwnd, message, wParam, lParam );
@@ -99,7 +220,7 @@ namespace
 		int screenWidth = GetSystemMetrics( SM_CXFULLSCREEN );
 		int screenHeight = GetSystemMetrics( SM_CYFULLSCREEN );
 
-		windowHandle = CreateWindowEx( 0, "WoTS_WndClass", "World of Tinyships [CLOSED ALPHA]", WS_CAPTION | WS_SYSMENU,
+		windowHandle = CreateWindowEx( 0, "WoTS_WndClass", WINDOW_TITLE, WS_CAPTION | WS_SYSMENU,
 								screenWidth / 2 - WINDOW_WIDTH / 2, screenHeight / 2 - WINDOW_HEIGHT / 2, windowRect.right - windowRect.left, windowRect.bottom - windowRect.top,
 								HWND_DESKTOP, nullptr, GetModuleHandle( nullptr ), nullptr );
 
@@ -141,7 +262,7 @@ namespace
 
 
 	//-------------------------------------------------------
-	void initOGL()
+	void initOGL( bool vsync )
 	{
 		windowDC = GetDC( windowHandle );
 
@@ -160,6 +281,11 @@ namespace
 
 		openGLHandle = wglCreateContext( windowDC );
 		wglMakeCurrent( windowDC, openGLHandle );
+
+		// WGL_EXT_swap_control is not in GL_EXTENSIONS, the function is there or not
+		BOOL ( WINAPI *swapInterval )( int interval );
+		if ( glext::load( &swapInterval, "wglSwapIntervalEXT" ) )
+			swapInterval( vsync ? 1 : 0 );
 	}
 
 
@@ -174,11 +300,108 @@ namespace
 	}
 
 
+	// Bitmap font display lists for the printable ASCII characters
+	constexpr int OVERLAY_FIRST_CHAR = 32;
+	constexpr int OVERLAY_CHAR_COUNT = 96;
+	constexpr int OVERLAY_LINE_HEIGHT = 14;
+	constexpr int OVERLAY_MARGIN = 8;
+	constexpr int OVERLAY_WIDTH = 440;
+
+	GLuint overlayFont = 0;
+
+
+	//-------------------------------------------------------
+	void initOverlay()
+	{
+		SelectObject( windowDC, GetStockObject( ANSI_FIXED_FONT ) );
+		overlayFont = glGenLists( OVERLAY_CHAR_COUNT );
+		if ( overlayFont && !wglUseFontBitmaps( windowDC, OVERLAY_FIRST_CHAR, OVERLAY_CHAR_COUNT, overlayFont ) )
+		{
+			glDeleteLists( overlayFont, OVERLAY_CHAR_COUNT );
+			overlayFont = 0;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void deinitOverlay()
+	{
+		if ( overlayFont )
+			glDeleteLists( overlayFont, OVERLAY_CHAR_COUNT );
+		overlayFont = 0;
+	}
+
+
+	//-------------------------------------------------------
+	void drawOverlayText( int x, int y, char const *text )
+	{
+		glRasterPos2f( ( float )x, ( float )y );
+		glListBase( overlayFont - OVERLAY_FIRST_CHAR );
+		glCallLists( ( GLsizei )std::strlen( text ), GL_UNSIGNED_BYTE, text );
+	}
+
+
+	//-------------------------------------------------------
+	void drawOverlay()
+	{
+		if ( !profiler::isEnabled() || !overlayFont )
+			return;
+
+		// Pixel coordinates, the origin is the bottom left corner of the window
+		glMatrixMode( GL_PROJECTION );
+		glLoadIdentity();
+		glOrtho( 0.0, WINDOW_WIDTH, 0.0, WINDOW_HEIGHT, -1.0, 1.0 );
+		glMatrixMode( GL_MODELVIEW );
+		glLoadIdentity();
+
+		int scopeCount = profiler::getScopeCount();
+		int top = WINDOW_HEIGHT - OVERLAY_MARGIN;
+		int bottom = top - ( scopeCount + 1 ) * OVERLAY_LINE_HEIGHT - OVERLAY_MARGIN;
+
+		glEnable( GL_BLEND );
+		glBlendFunc( GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA );
+		glColor4f( 0.f, 0.f, 0.f, 0.6f );
+		glBegin( GL_QUADS );
+		glVertex2f( ( float )OVERLAY_MARGIN, ( float )bottom );
+		glVertex2f( ( float )( OVERLAY_MARGIN + OVERLAY_WIDTH ), ( float )bottom );
+		glVertex2f( ( float )( OVERLAY_MARGIN + OVERLAY_WIDTH ), ( float )top );
+		glVertex2f( ( float )OVERLAY_MARGIN, ( float )top );
+		glEnd();
+		glDisable( GL_BLEND );
+
+		char line[ 128 ];
+		int x = OVERLAY_MARGIN * 2;
+		int y = top - OVERLAY_LINE_HEIGHT;
+		glColor3f( 1.f, 1.f, 1.f );
+		std::snprintf( line, sizeof( line ), "%-24s %8s %8s %8s", "ms", "min", "avg", "p99" );
+		drawOverlayText( x, y, line );
+
+		for ( int i = 0; i < scopeCount; ++i )
+		{
+			profiler::Statistics stats = profiler::getStatistics( i );
+			y -= OVERLAY_LINE_HEIGHT;
+			std::snprintf( line, sizeof( line ), "%-24s %8.3f %8.3f %8.3f",
+						   profiler::getScopeName( i ), stats.min * 1e3, stats.average * 1e3, stats.p99 * 1e3 );
+			drawOverlayText( x, y, line );
+		}
+	}
+
+
 	//-------------------------------------------------------
 	void draw()
 	{
-		scene::draw();
-		SwapBuffers( windowDC );
+		static telemetry::Histogram const drawTime( "engine.draw_ns" );
+		static telemetry::Histogram const swapTime( "engine.swap_ns" );
+		{
+			telemetry::Timer timer( drawTime );
+			scene::draw();
+			drawOverlay();
+		}
+		{
+			PROFILE_SCOPE( "SwapBuffers" );
+			telemetry::Timer timer( swapTime );
+			SwapBuffers( windowDC );
+		}
 
 		assert( glGetError() == 0 );
 	}
@@ -191,39 +414,162 @@ namespace
 
 namespace
 {
-	constexpr int MAX_FPS = 150;
+	constexpr int DEFAULT_MAX_FPS = 150;
+	constexpr int DEFAULT_TICK_RATE = 60;
+	constexpr int MAX_STEPS_PER_FRAME = 5;
+	constexpr int DEFAULT_TRACE_FRAMES = 300;
+	constexpr std::size_t FRAME_ARENA_SIZE = 1024 * 1024;
+
+	// Waitable timers wake up a bit late, the last part of the frame is spun to hit the deadline exactly
+	constexpr double SPIN_TIME = 0.001;
+	constexpr double LOW_RESOLUTION_SPIN_TIME = 0.002;
 
 	LARGE_INTEGER clockFrequency;
 	LARGE_INTEGER clockLastTick;
 
+	LONGLONG frameTicks = 0;	// 0 when the frame rate is not capped
+	LONGLONG spinTicks = 0;
+	HANDLE frameTimer = nullptr;
+	bool lowResolutionTimer = false;
+
+	// Phase times for the telemetry, draw and SwapBuffers are recorded by draw()
+	telemetry::Histogram const particlesTime( "engine.particles_ns" );
+	telemetry::Histogram const gameTime( "engine.game_ns" );
+	telemetry::Histogram const sceneTime( "engine.scene_ns" );
+	telemetry::Histogram const publishTime( "engine.publish_ns" );
+	telemetry::Histogram const frameTime( "engine.frame_ns" );
+
 
 	//-------------------------------------------------------
-	void initClock()
+	void initClock( int maxFps )
 	{
 		QueryPerformanceFrequency( &clockFrequency );
 		QueryPerformanceCounter( &clockLastTick );
+
+		frameTicks = maxFps > 0 ? clockFrequency.QuadPart / maxFps : 0;
+		if ( frameTicks == 0 )
+			return;
+
+		// High resolution timers exist since Windows 10 1803, older systems need the global timer period lowered
+		frameTimer = CreateWaitableTimerEx( nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS );
+		if ( !frameTimer )
+		{
+			frameTimer = CreateWaitableTimer( nullptr, TRUE, nullptr );
+			timeBeginPeriod( 1 );
+			lowResolutionTimer = true;
+		}
+		spinTicks = ( LONGLONG )( ( lowResolutionTimer ? LOW_RESOLUTION_SPIN_TIME : SPIN_TIME ) * clockFrequency.QuadPart );
 	}
 
 
 	//-------------------------------------------------------
-	void update()
+	void deinitClock()
 	{
-		float dt = 0.f;
+		if ( frameTimer )
+			CloseHandle( frameTimer );
+		if ( lowResolutionTimer )
+			timeEndPeriod( 1 );
+		frameTimer = nullptr;
+		lowResolutionTimer = false;
+	}
 
-		while ( true )
+
+	//-------------------------------------------------------
+	float waitFrame()
+	{
+		PROFILE_SCOPE( "engine::waitFrame" );
+		LARGE_INTEGER clockTick;
+		QueryPerformanceCounter( &clockTick );
+
+		if ( frameTicks > 0 )
 		{
-			LARGE_INTEGER clockTick;
+			LONGLONG deadline = clockLastTick.QuadPart + frameTicks;
+			LONGLONG sleepTicks = deadline - clockTick.QuadPart - spinTicks;
+			if ( sleepTicks > 0 && frameTimer )
+			{
+				// Negative due time is relative, in 100 ns units
+				LARGE_INTEGER dueTime;
+				dueTime.QuadPart = -( sleepTicks * 10000000 / clockFrequency.QuadPart );
+				if ( SetWaitableTimer( frameTimer, &dueTime, 0, nullptr, nullptr, FALSE ) )
+					WaitForSingleObject( frameTimer, INFINITE );
+			}
+
 			QueryPerformanceCounter( &clockTick );
-			double deltaTime = ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart;
-			if ( deltaTime >= 1.0 / MAX_FPS )
+			while ( clockTick.QuadPart < deadline )
 			{
-				dt = ( float )deltaTime;
-				clockLastTick = clockTick;
-				break;
+				YieldProcessor();
+				QueryPerformanceCounter( &clockTick );
 			}
 		}
 
-		game::update( dt );
+		double deltaTime = ( double )( clockTick.QuadPart - clockLastTick.QuadPart ) / ( double )clockFrequency.QuadPart;
+		clockLastTick = clockTick;
+		return ( float )deltaTime;
+	}
+
+
+	// Frame time statistics, shown in the window title once per second
+	struct FrameStatistics
+	{
+		double time = 0.0;
+		double sum = 0.0;
+		double squaredSum = 0.0;
+		double max = 0.0;
+		int count = 0;
+	};
+
+
+	FrameStatistics frameStatistics;
+
+
+	//-------------------------------------------------------
+	void reportFrame( float dt, double targetTime )
+	{
+		FrameStatistics &stats = frameStatistics;
+		stats.time += dt;
+		stats.sum += dt;
+		stats.squaredSum += ( double )dt * dt;
+		stats.max = std::max( stats.max, ( double )dt );
+		++stats.count;
+		if ( stats.time < 1.0 )
+			return;
+
+		// Jitter is the standard deviation of the frame time, or the deviation from the target when capped
+		double mean = stats.sum / stats.count;
+		double center = targetTime > 0.0 ? targetTime : mean;
+		double variance = stats.squaredSum / stats.count - 2.0 * center * mean + center * center;
+		double jitter = std::sqrt( std::max( variance, 0.0 ) );
+
+		char title[ 256 ];
+		std::snprintf( title, sizeof( title ), "%s - %.0f fps, frame %.2f ms, jitter %.3f ms, max %.2f ms",
+					   WINDOW_TITLE, stats.count / stats.time, mean * 1e3, jitter * 1e3, stats.max * 1e3 );
+		SetWindowText( windowHandle, title );
+		stats = FrameStatistics();
+	}
+
+
+	//-------------------------------------------------------
+	void update( float dt )
+	{
+		// The window thread only queues input, it takes effect here, at the step boundary
+		replay::dispatchInput();
+
+		// Frame temporaries of a step die with it, any number of steps fit into the same arena
+		memory::FrameScope frameScope;
+		scene::beginUpdate();
+
+		// Particles don't depend on the game state, so they are updated together with the game
+		jobs::Counter particlesCounter;
+		auto updateParticles = [ dt ]{ telemetry::Timer timer( particlesTime ); scene::updateParticles( dt ); };
+		jobs::run( particlesCounter, updateParticles );
+
+		{
+			PROFILE_SCOPE( "game::update" );
+			telemetry::Timer timer( gameTime );
+			game::update( dt );
+		}
+		jobs::wait( particlesCounter );
+		telemetry::Timer timer( sceneTime );
 		scene::update( dt );
 	}
 }
@@ -235,19 +581,89 @@ namespace
 
 namespace engine
 {
-	void run()
+	void run( int argc, char **argv )
 	{
+		options::parse( argc, argv );
+		jobs::init( options::getInt( "threads", jobs::getDefaultWorkerCount() ) );
+		memory::init( FRAME_ARENA_SIZE );
+
+		// --max-fps 0 disables the limiter, --vsync leaves pacing to the swap chain
+		bool vsync = options::has( "vsync" );
+		int maxFps = options::getInt( "max-fps", vsync ? 0 : DEFAULT_MAX_FPS );
+
+		// --profile shows the overlay from the start (F3 toggles it), --profile-trace writes a Chrome trace on exit
+		profiler::init( options::has( "profile" ), options::getString( "profile-trace", nullptr ),
+						options::getInt( "profile-trace-frames", DEFAULT_TRACE_FRAMES ) );
+
+		// --telemetry FILE appends the metrics to FILE, or a named pipe, every --telemetry-interval seconds
+		telemetry::init( options::getString( "telemetry", nullptr ), options::getFloat( "telemetry-interval", 1.f ) );
+
 		initWindow();
-		initOGL();
-		initClock();
+		initOGL( vsync );
+		streambuffer::init();
+		scene::initDraw();
+		scene::setViewportSize( WINDOW_WIDTH, WINDOW_HEIGHT );
+		initOverlay();
+		initClock( maxFps );
+
+		// The game is always simulated with a fixed step, rendering interpolates between the steps
+		FixedTimestep timestep( 1.f / options::getInt( "tick-rate", DEFAULT_TICK_RATE ), MAX_STEPS_PER_FRAME );
+
+		// --record FILE logs the input and frame times, --replay FILE plays such a log instead of the live input
+		if ( options::has( "record" ) )
+			replay::startRecording( options::getString( "record", "" ) );
+		else if ( options::has( "replay" ) )
+			replay::startReplay( options::getString( "replay", "" ) );
+
+		// --snapshot FILE starts from a saved simulation state, e.g. one written by the headless --save-snapshot
 		game::init();
+		if ( options::has( "snapshot" ) )
+			game::loadSnapshot( options::getString( "snapshot", "" ) );
+		scene::publish( 0.f );
 		while ( processWindowMessages() )
 		{
-			update();
+			// Frame N + 1 is simulated while frame N is drawn from the published scene
+			float dt = waitFrame();
+			reportFrame( dt, maxFps > 0 ? 1.0 / maxFps : 0.0 );
+
+			// A replayed frame is simulated with its recorded dt, live input takes over at the end of the log
+			if ( replay::isReplaying() && !replay::playFrame( &dt ) )
+				replay::stop();
+			replay::recordFrame( dt );
+
+			// From here on the frame must not touch the heap, restarts queued by the input begin a new warm-up
+			memory::beginFrame();
+			int steps = timestep.advance( dt );
+			jobs::Counter updateCounter;
+			auto updateFrame = [ steps, &timestep ]
+			{
+				for ( int i = 0; i < steps; ++i )
+					update( timestep.getStep() );
+			};
+			jobs::run( updateCounter, updateFrame );
 			draw();
+			jobs::wait( updateCounter );
+			if ( replay::isReplaying() )
+				scene::getCamera( &cameraX, &cameraY, &cameraZoom );
+			{
+				telemetry::Timer timer( publishTime );
+				scene::publish( timestep.getAlpha() );
+			}
+			memory::endFrame();
+			profiler::endFrame( dt );
+			frameTime.record( ( std::int64_t )( dt * 1e9 ) );
 		}
 		game::deinit();
+		replay::stop();
+		deinitClock();
+		deinitOverlay();
+		scene::deinitDraw();
+		streambuffer::deinit();
 		deinitOGL();
 		deinitWindow();
+		telemetry::deinit();
+		profiler::deinit();
+		memory::deinit();
+		jobs::deinit();
 	}
 }
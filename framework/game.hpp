@@ -18,5 +18,12 @@ namespace game
 	void keyPressed( int key );
 	void keyReleased( int key );
 	void mouseClicked( float x, float y, bool isLeftButton );
+
+	// Whole simulation state in a flat binary file, for starting scenarios without simulating up to them
+	// A snapshot is loaded into an initialized game, it replaces the state init made from the options
+	// Loading is done outside frames, it allocates. False if the file can't be written or read, or is
+	// not a snapshot of this build's version: the game keeps running from a fresh init then
+	bool saveSnapshot( char const *path );
+	bool loadSnapshot( char const *path );
 }
 
@@ -0,0 +1,38 @@
+#include <windows.h>
+#include <GL/gl.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "glext.hpp"
+
+
+//-------------------------------------------------------
+//	public extension loading interface
+//-------------------------------------------------------
+
+namespace glext
+{
+	//-------------------------------------------------------
+	bool hasExtension( char const *name )
+	{
+		char const *extensions = ( char const * )glGetString( GL_EXTENSIONS );
+		if ( !extensions )
+			return false;
+
+		std::size_t length = std::strlen( name );
+		for ( char const *found = std::strstr( extensions, name ); found; found = std::strstr( found + length, name ) )
+			if ( ( found == extensions || found[ -1 ] == ' ' ) && ( found[ length ] == ' ' || found[ length ] == 0 ) )
+				return true;
+		return false;
+	}
+
+
+	//-------------------------------------------------------
+	void *getProcAddress( char const *name )
+	{
+		// Some drivers return small integers instead of null for missing functions
+		std::intptr_t address = ( std::intptr_t )wglGetProcAddress( name );
+		return ( address >= -1 && address <= 3 ) ? nullptr : ( void * )address;
+	}
+}
@@ -0,0 +1,26 @@
+//-------------------------------------------------------
+//	OpenGL extension loading
+//-------------------------------------------------------
+
+/*
+ * The system headers stop at OpenGL 1.1: the modules declare the newer functions and constants they use
+ * themselves and load the functions through wglGetProcAddress, after checking the extensions which provide them
+ * Everything here needs the current OpenGL context and is not available in the headless build
+ */
+
+
+namespace glext
+{
+	// Whole names in the GL_EXTENSIONS string only, "GL_ARB_sync" doesn't match "GL_ARB_sync2"
+	bool hasExtension( char const *name );
+
+	// nullptr for a function, which the driver doesn't provide
+	void *getProcAddress( char const *name );
+
+	template< class Function >
+	bool load( Function *function, char const *name )
+	{
+		*function = ( Function )getProcAddress( name );
+		return *function != nullptr;
+	}
+}
@@ -0,0 +1,164 @@
+#include <algorithm>
+#include <atomic>
+
+#include "input.hpp"
+#include "profiler.hpp"
+
+
+//-------------------------------------------------------
+//	event ring
+//-------------------------------------------------------
+
+namespace
+{
+	static_assert( ( input::QUEUE_CAPACITY & ( input::QUEUE_CAPACITY - 1 ) ) == 0, "indices wrap by masking" );
+
+	constexpr std::uint32_t INDEX_MASK = input::QUEUE_CAPACITY - 1;
+	constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+
+	// Indices only grow, their difference is the number of queued events. Every side keeps its own index
+	// and a cached copy of the other one on its own cache line, so the sides only share a line when
+	// the cached copy runs out
+	struct alignas( CACHE_LINE_SIZE ) ProducerState
+	{
+		std::atomic< std::uint32_t > tail{ 0 };
+		std::uint32_t cachedHead = 0;
+	};
+
+
+	struct alignas( CACHE_LINE_SIZE ) ConsumerState
+	{
+		std::atomic< std::uint32_t > head{ 0 };
+		std::uint32_t cachedTail = 0;
+		std::int64_t maxLatency = 0;
+	};
+
+
+	input::Event events[ input::QUEUE_CAPACITY ];
+	ProducerState producer;
+	ConsumerState consumer;
+	std::atomic< std::size_t > droppedCount{ 0 };
+
+
+	//-------------------------------------------------------
+	input::Event makeEvent( input::EventType type )
+	{
+		input::Event event = {};
+		event.type = type;
+		return event;
+	}
+}
+
+
+//-------------------------------------------------------
+//	public input interface
+//-------------------------------------------------------
+
+namespace input
+{
+	//-------------------------------------------------------
+	bool push( Event const &event )
+	{
+		std::uint32_t tail = producer.tail.load( std::memory_order_relaxed );
+		if ( tail - producer.cachedHead == QUEUE_CAPACITY )
+		{
+			producer.cachedHead = consumer.head.load( std::memory_order_acquire );
+			if ( tail - producer.cachedHead == QUEUE_CAPACITY )
+			{
+				droppedCount.fetch_add( 1, std::memory_order_relaxed );
+				return false;
+			}
+		}
+
+		// The release store publishes the event written before it
+		Event &slot = events[ tail & INDEX_MASK ];
+		slot = event;
+		slot.time = profiler::getTicks();
+		producer.tail.store( tail + 1, std::memory_order_release );
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	bool pushKeyPressed( int key )
+	{
+		Event event = makeEvent( EVENT_KEY_DOWN );
+		event.key = ( std::uint8_t )key;
+		return push( event );
+	}
+
+
+	//-------------------------------------------------------
+	bool pushKeyReleased( int key )
+	{
+		Event event = makeEvent( EVENT_KEY_UP );
+		event.key = ( std::uint8_t )key;
+		return push( event );
+	}
+
+
+	//-------------------------------------------------------
+	bool pushMouseClicked( float x, float y, bool isLeftButton )
+	{
+		Event event = makeEvent( EVENT_CLICK );
+		event.x = x;
+		event.y = y;
+		event.isLeftButton = isLeftButton;
+		return push( event );
+	}
+
+
+	//-------------------------------------------------------
+	bool pushRestart()
+	{
+		return push( makeEvent( EVENT_RESTART ) );
+	}
+
+
+	//-------------------------------------------------------
+	bool pushCamera( float x, float y, float zoom )
+	{
+		Event event = makeEvent( EVENT_CAMERA );
+		event.x = x;
+		event.y = y;
+		event.zoom = zoom;
+		return push( event );
+	}
+
+
+	//-------------------------------------------------------
+	bool pop( Event *event )
+	{
+		std::uint32_t head = consumer.head.load( std::memory_order_relaxed );
+		if ( head == consumer.cachedTail )
+		{
+			consumer.cachedTail = producer.tail.load( std::memory_order_acquire );
+			if ( head == consumer.cachedTail )
+				return false;
+		}
+
+		// The slot is handed back to the producer by the release store, after it was read
+		*event = events[ head & INDEX_MASK ];
+		consumer.head.store( head + 1, std::memory_order_release );
+		consumer.maxLatency = std::max( consumer.maxLatency, profiler::getTicks() - event->time );
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	std::size_t getDroppedCount()
+	{
+		return droppedCount.load( std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	double takeMaxLatency()
+	{
+		double frequency = profiler::getTickFrequency();
+		double latency = frequency > 0.0 ? consumer.maxLatency / frequency : 0.0;
+		consumer.maxLatency = 0;
+		return latency;
+	}
+}
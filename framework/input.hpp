@@ -0,0 +1,61 @@
+//-------------------------------------------------------
+//	input event queue
+//-------------------------------------------------------
+
+/*
+ * Game input is produced by the window thread and consumed by the simulation: the window pushes events
+ * into a lock-free single producer, single consumer ring, the simulation pops them at the start of every
+ * fixed step (see replay::dispatchInput). Neither side ever waits for the other
+ *
+ * One thread at a time may push and one thread at a time may pop, the two may differ
+ * A full queue drops the new event and counts it, the producer is never blocked
+ */
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace input
+{
+	constexpr int QUEUE_CAPACITY = 256;
+
+
+	enum EventType : std::uint8_t
+	{
+		EVENT_KEY_DOWN,
+		EVENT_KEY_UP,
+		EVENT_CLICK,
+		EVENT_RESTART,
+		EVENT_CAMERA
+	};
+
+
+	struct Event
+	{
+		EventType type;
+		std::uint8_t key;			// KEY_DOWN, KEY_UP
+		bool isLeftButton;			// CLICK
+		float x;					// CLICK, CAMERA
+		float y;
+		float zoom;					// CAMERA
+		std::int64_t time;			// profiler ticks of the push
+	};
+
+
+	// Producer side, false when the queue is full and the event is dropped
+	bool push( Event const &event );
+	bool pushKeyPressed( int key );
+	bool pushKeyReleased( int key );
+	bool pushMouseClicked( float x, float y, bool isLeftButton );
+	bool pushRestart();
+	bool pushCamera( float x, float y, float zoom );
+
+	// Consumer side, false when the queue is empty
+	bool pop( Event *event );
+
+	// Events dropped on a full queue since the start
+	std::size_t getDroppedCount();
+
+	// The longest time a popped event waited in the queue since the last call, in seconds, consumer side
+	double takeMaxLatency();
+}
@@ -0,0 +1,227 @@
+
+#include <cassert>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "jobs.hpp"
+
+
+//-------------------------------------------------------
+//	per-thread job queues
+//-------------------------------------------------------
+
+namespace
+{
+	struct Job
+	{
+		jobs::JobFunction function;
+		void const *callable;
+		int begin;
+		int end;
+		jobs::Counter *counter;
+	};
+
+
+	// Fixed capacity deque: the owner pushes and pops at the back, thieves take from the front
+	class JobQueue
+	{
+	public:
+		static constexpr int CAPACITY = 4096;
+
+		bool push( Job const &job );
+		bool pop( Job *job );
+		bool steal( Job *job );
+
+	private:
+		std::mutex mutex;
+		Job jobs[ CAPACITY ];
+		int head = 0;
+		int size = 0;
+	};
+
+
+	//-------------------------------------------------------
+	bool JobQueue::push( Job const &job )
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		if ( size == CAPACITY )
+			return false;
+		jobs[ ( head + size ) % CAPACITY ] = job;
+		++size;
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	bool JobQueue::pop( Job *job )
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		if ( size == 0 )
+			return false;
+		--size;
+		*job = jobs[ ( head + size ) % CAPACITY ];
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	bool JobQueue::steal( Job *job )
+	{
+		std::lock_guard< std::mutex > lock( mutex );
+		if ( size == 0 )
+			return false;
+		*job = jobs[ head ];
+		head = ( head + 1 ) % CAPACITY;
+		--size;
+		return true;
+	}
+}
+
+
+//-------------------------------------------------------
+//	workers
+//-------------------------------------------------------
+
+namespace
+{
+	std::vector< std::thread > workers;
+	std::unique_ptr< JobQueue[] > queues;	// queue 0 belongs to the main thread
+	int queueCount = 0;
+
+	thread_local int threadIndex = 0;
+
+	std::atomic< int > queuedJobs{ 0 };
+	std::atomic< bool > stopping{ false };
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+
+
+	//-------------------------------------------------------
+	void execute( Job const &job )
+	{
+		job.function( job.callable, job.begin, job.end );
+		job.counter->pending.fetch_sub( 1, std::memory_order_release );
+	}
+
+
+	//-------------------------------------------------------
+	bool findJob( Job *job )
+	{
+		if ( queues[ threadIndex ].pop( job ) )
+		{
+			queuedJobs.fetch_sub( 1 );
+			return true;
+		}
+		for ( int i = 1; i < queueCount; ++i )
+		{
+			if ( queues[ ( threadIndex + i ) % queueCount ].steal( job ) )
+			{
+				queuedJobs.fetch_sub( 1 );
+				return true;
+			}
+		}
+		return false;
+	}
+
+
+	//-------------------------------------------------------
+	void workerLoop( int index )
+	{
+		threadIndex = index;
+		while ( !stopping )
+		{
+			Job job;
+			if ( findJob( &job ) )
+			{
+				execute( job );
+				continue;
+			}
+
+			std::unique_lock< std::mutex > lock( sleepMutex );
+			wakeUp.wait( lock, []{ return stopping || queuedJobs > 0; } );
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	public interface
+//-------------------------------------------------------
+
+namespace jobs
+{
+	void init( int workerCount )
+	{
+		assert( workers.empty() && workerCount >= 0 );
+		queueCount = workerCount + 1;
+		queues.reset( new JobQueue[ queueCount ] );
+		stopping = false;
+		for ( int i = 1; i <= workerCount; ++i )
+			workers.emplace_back( workerLoop, i );
+	}
+
+
+	void deinit()
+	{
+		{
+			std::lock_guard< std::mutex > lock( sleepMutex );
+			stopping = true;
+		}
+		wakeUp.notify_all();
+		for ( std::thread &worker : workers )
+			worker.join();
+		workers.clear();
+		queues.reset();
+		queueCount = 0;
+	}
+
+
+	int getWorkerCount()
+	{
+		return ( int )workers.size();
+	}
+
+
+	int getDefaultWorkerCount()
+	{
+		int hardwareThreads = ( int )std::thread::hardware_concurrency();
+		return hardwareThreads > 1 ? hardwareThreads - 1 : 0;
+	}
+
+
+	void submit( Counter &counter, JobFunction function, void const *callable, int begin, int end )
+	{
+		Job job = { function, callable, begin, end, &counter };
+		counter.pending.fetch_add( 1, std::memory_order_relaxed );
+
+		// Single-threaded mode, or the queue is full: run in place
+		if ( queueCount <= 1 || !queues[ threadIndex ].push( job ) )
+		{
+			execute( job );
+			return;
+		}
+
+		queuedJobs.fetch_add( 1 );
+		{
+			// Taking the lock guarantees, that a worker checking the predicate either sees the job or is already waiting
+			std::lock_guard< std::mutex > lock( sleepMutex );
+		}
+		wakeUp.notify_one();
+	}
+
+
+	void wait( Counter &counter )
+	{
+		while ( counter.pending.load( std::memory_order_acquire ) > 0 )
+		{
+			Job job;
+			if ( queueCount > 1 && findJob( &job ) )
+				execute( job );
+			else
+				std::this_thread::yield();
+		}
+	}
+}
@@ -0,0 +1,66 @@
+
+#include <atomic>
+
+
+//-------------------------------------------------------
+//	job system
+//-------------------------------------------------------
+
+// Work-stealing scheduler. Every thread has its own queue, idle threads steal from the others,
+// and a thread waiting for a counter executes pending jobs instead of blocking.
+// With zero workers all jobs run inline at the point of submission, in submission order,
+// so results don't depend on the number of threads as long as jobs don't share mutable state.
+
+namespace jobs
+{
+	struct Counter
+	{
+		std::atomic< int > pending{ 0 };
+	};
+
+
+	typedef void ( *JobFunction )( void const *callable, int begin, int end );
+
+
+	void init( int workerCount );
+	void deinit();
+	int getWorkerCount();
+
+	// Default for the "threads" option: one worker less than hardware threads, the main thread works too
+	int getDefaultWorkerCount();
+
+	void submit( Counter &counter, JobFunction function, void const *callable, int begin, int end );
+	void wait( Counter &counter );
+
+
+	//-------------------------------------------------------
+	// Runs function() as a job, the function object must stay alive until wait( counter ) returns
+	template< class Function >
+	void run( Counter &counter, Function const &function )
+	{
+		submit( counter, []( void const *callable, int, int ){ ( *static_cast< Function const* >( callable ) )(); }, &function, 0, 0 );
+	}
+
+
+	//-------------------------------------------------------
+	// Calls function( begin, end ) for consecutive chunks of [0, count) and waits for all of them.
+	// Chunk boundaries depend only on chunkSize, never on the number of threads.
+	template< class Function >
+	void parallelFor( int count, int chunkSize, Function const &function )
+	{
+		if ( count <= chunkSize )
+		{
+			if ( count > 0 )
+				function( 0, count );
+			return;
+		}
+
+		Counter counter;
+		for ( int begin = 0; begin < count; begin += chunkSize )
+		{
+			int end = begin + chunkSize < count ? begin + chunkSize : count;
+			submit( counter, []( void const *callable, int begin, int end ){ ( *static_cast< Function const* >( callable ) )( begin, end ); }, &function, begin, end );
+		}
+		wait( counter );
+	}
+}
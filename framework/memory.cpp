@@ -0,0 +1,322 @@
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+
+#include "memory.hpp"
+
+
+//-------------------------------------------------------
+//	heap guard
+//-------------------------------------------------------
+
+namespace
+{
+	std::atomic< std::size_t > heapAllocations{ 0 };
+	std::atomic< std::size_t > guardedAllocations{ 0 };
+	std::atomic< bool > guardArmed{ false };
+	thread_local int heapScopeDepth = 0;
+
+	int warmupFramesLeft = memory::WARMUP_FRAMES;
+	int frameIndex = 0;
+
+
+	//-------------------------------------------------------
+	void countAllocation( std::size_t size )
+	{
+		heapAllocations.fetch_add( 1, std::memory_order_relaxed );
+		if ( !guardArmed.load( std::memory_order_relaxed ) || heapScopeDepth > 0 )
+			return;
+
+		guardedAllocations.fetch_add( 1, std::memory_order_relaxed );
+#ifndef NDEBUG
+		// Right at the allocation, so the debugger shows who did it
+		std::fprintf( stderr, "memory: heap allocation of %zu bytes in frame %d after warm-up\n", size, frameIndex );
+		std::abort();
+#endif
+	}
+}
+
+
+//-------------------------------------------------------
+// All the forms are replaced, not just the ones the library forwards to, so tools which hook the
+// allocator themselves still see matching pairs
+void *operator new( std::size_t size )
+{
+	countAllocation( size );
+	void *pointer = std::malloc( size > 0 ? size : 1 );
+	if ( !pointer )
+		throw std::bad_alloc();
+	return pointer;
+}
+
+
+//-------------------------------------------------------
+void *operator new[]( std::size_t size )
+{
+	return ::operator new( size );
+}
+
+
+//-------------------------------------------------------
+void *operator new( std::size_t size, std::nothrow_t const & ) noexcept
+{
+	countAllocation( size );
+	return std::malloc( size > 0 ? size : 1 );
+}
+
+
+//-------------------------------------------------------
+void *operator new[]( std::size_t size, std::nothrow_t const &nothrow ) noexcept
+{
+	return ::operator new( size, nothrow );
+}
+
+
+//-------------------------------------------------------
+void operator delete( void *pointer ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+void operator delete[]( void *pointer ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+void operator delete( void *pointer, std::size_t ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+void operator delete[]( void *pointer, std::size_t ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+void operator delete( void *pointer, std::nothrow_t const & ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+void operator delete[]( void *pointer, std::nothrow_t const & ) noexcept
+{
+	std::free( pointer );
+}
+
+
+//-------------------------------------------------------
+//	frame arena
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr std::size_t MIN_ARENA_SIZE = 64 * 1024;
+
+	char *arena = nullptr;
+	std::size_t arenaSize = 0;
+
+	// Counts the requests past the end of the arena too, they are the size the arena has to grow to
+	std::atomic< std::size_t > arenaUsed{ 0 };
+	std::size_t highWater = 0;
+
+
+	// Heap blocks for the requests, which didn't fit, newest first, released by beginFrame or their frame scope
+	struct OverflowBlock
+	{
+		OverflowBlock *next;
+	};
+
+
+	std::mutex overflowMutex;
+	OverflowBlock *overflowBlocks = nullptr;
+
+
+	//-------------------------------------------------------
+	char *alignPointer( char *pointer, std::size_t alignment )
+	{
+		std::uintptr_t address = reinterpret_cast< std::uintptr_t >( pointer );
+		return reinterpret_cast< char * >( ( address + alignment - 1 ) & ~( std::uintptr_t )( alignment - 1 ) );
+	}
+
+
+	//-------------------------------------------------------
+	void *allocateOverflow( std::size_t paddedSize, std::size_t alignment )
+	{
+		char *bytes = static_cast< char * >( ::operator new( sizeof( OverflowBlock ) + paddedSize ) );
+		OverflowBlock *block = reinterpret_cast< OverflowBlock * >( bytes );
+		{
+			std::lock_guard< std::mutex > lock( overflowMutex );
+			block->next = overflowBlocks;
+			overflowBlocks = block;
+		}
+		return alignPointer( bytes + sizeof( OverflowBlock ), alignment );
+	}
+
+
+	//-------------------------------------------------------
+	void releaseOverflow( OverflowBlock *mark = nullptr )
+	{
+		while ( overflowBlocks != mark )
+		{
+			OverflowBlock *next = overflowBlocks->next;
+			::operator delete( overflowBlocks );
+			overflowBlocks = next;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void resizeArena( std::size_t size )
+	{
+		::operator delete( arena );
+		arena = size > 0 ? static_cast< char * >( ::operator new( size ) ) : nullptr;
+		arenaSize = size;
+	}
+}
+
+
+//-------------------------------------------------------
+//	public memory interface
+//-------------------------------------------------------
+
+namespace memory
+{
+	//-------------------------------------------------------
+	void init( std::size_t frameArenaSize )
+	{
+		releaseOverflow();
+		resizeArena( frameArenaSize );
+		arenaUsed.store( 0 );
+		highWater = 0;
+		beginWarmup();
+	}
+
+
+	//-------------------------------------------------------
+	void deinit()
+	{
+		guardArmed.store( false );
+		releaseOverflow();
+		resizeArena( 0 );
+		arenaUsed.store( 0 );
+		highWater = 0;
+	}
+
+
+	//-------------------------------------------------------
+	void beginFrame()
+	{
+		releaseOverflow();
+		highWater = std::max( highWater, arenaUsed.load( std::memory_order_relaxed ) );
+		if ( highWater > arenaSize )
+		{
+			std::size_t size = std::max( MIN_ARENA_SIZE, arenaSize );
+			while ( size < highWater )
+				size *= 2;
+			resizeArena( size );
+		}
+		arenaUsed.store( 0, std::memory_order_relaxed );
+		highWater = 0;
+
+		++frameIndex;
+		if ( warmupFramesLeft > 0 )
+			--warmupFramesLeft;
+		else
+			guardArmed.store( true, std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	void endFrame()
+	{
+		guardArmed.store( false, std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	void beginWarmup()
+	{
+		warmupFramesLeft = WARMUP_FRAMES;
+		guardArmed.store( false, std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	void *allocateFrame( std::size_t size, std::size_t alignment )
+	{
+		assert( alignment > 0 && ( alignment & ( alignment - 1 ) ) == 0 && alignment <= MAX_ALIGNMENT );
+		std::size_t paddedSize = size + alignment - 1;
+		std::size_t offset = arenaUsed.fetch_add( paddedSize, std::memory_order_relaxed );
+		if ( offset + paddedSize <= arenaSize )
+			return alignPointer( arena + offset, alignment );
+		return allocateOverflow( paddedSize, alignment );
+	}
+
+
+	//-------------------------------------------------------
+	std::size_t getFrameArenaSize()
+	{
+		return arenaSize;
+	}
+
+
+	//-------------------------------------------------------
+	std::size_t getHeapAllocationCount()
+	{
+		return heapAllocations.load( std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	std::size_t getGuardedAllocationCount()
+	{
+		return guardedAllocations.load( std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	FrameScope::FrameScope() :
+		mark( arenaUsed.load( std::memory_order_relaxed ) ),
+		overflowMark( overflowBlocks )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	FrameScope::~FrameScope()
+	{
+		// The arena grows at the next beginFrame to what the scope needed
+		highWater = std::max( highWater, arenaUsed.load( std::memory_order_relaxed ) );
+		arenaUsed.store( mark, std::memory_order_relaxed );
+		releaseOverflow( static_cast< OverflowBlock * >( overflowMark ) );
+	}
+
+
+	//-------------------------------------------------------
+	HeapScope::HeapScope()
+	{
+		++heapScopeDepth;
+	}
+
+
+	//-------------------------------------------------------
+	HeapScope::~HeapScope()
+	{
+		--heapScopeDepth;
+	}
+}
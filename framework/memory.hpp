@@ -0,0 +1,86 @@
+//-------------------------------------------------------
+//	frame memory and heap guard
+//-------------------------------------------------------
+
+/*
+ * Temporaries, which live until the end of the frame, come from a linear arena: allocation is one atomic add,
+ * everything is released at once by the next beginFrame. When a frame needs more than the arena holds,
+ * the rest comes from the heap and the arena grows to the high water mark at the next beginFrame
+ *
+ * The heap guard counts global operator new calls. Once the frames after the last beginWarmup are done,
+ * the frame loop is expected not to touch the heap between beginFrame and endFrame:
+ * debug builds abort right at such an allocation, release builds count it
+ * Loading, restarts and other expected allocations go through beginWarmup or a HeapScope
+ */
+
+#include <cstddef>
+#include <type_traits>
+
+
+namespace memory
+{
+	constexpr int WARMUP_FRAMES = 120;
+	constexpr std::size_t DEFAULT_ALIGNMENT = 16;
+	constexpr std::size_t MAX_ALIGNMENT = 64;
+
+
+	void init( std::size_t frameArenaSize );
+	void deinit();
+
+	// Frame loop only: beginFrame releases the temporaries of the previous frame, so none may be alive
+	void beginFrame();
+	void endFrame();
+
+	// The next WARMUP_FRAMES frames may allocate: filling pools and caches after loading or a restart
+	void beginWarmup();
+
+	// Thread safe, never returns null, the memory is valid until the next beginFrame
+	// Alignment is a power of two up to MAX_ALIGNMENT
+	void *allocateFrame( std::size_t size, std::size_t alignment = DEFAULT_ALIGNMENT );
+
+	// Releases the temporaries allocated inside the scope at its end, for work repeated within a frame
+	// like simulation steps. Scopes nest. While a scope ends, no other thread may allocate frame memory
+	class FrameScope
+	{
+	public:
+		FrameScope();
+		~FrameScope();
+
+		FrameScope( FrameScope const & ) = delete;
+		FrameScope &operator = ( FrameScope const & ) = delete;
+
+	private:
+		std::size_t mark;
+		void *overflowMark;
+	};
+
+
+	//-------------------------------------------------------
+	// Uninitialized array, elements are never destroyed
+	template< class Type >
+	Type *allocateFrameArray( std::size_t count )
+	{
+		static_assert( std::is_trivially_destructible< Type >::value, "frame memory is released without destructors" );
+		static_assert( alignof( Type ) <= MAX_ALIGNMENT, "frame memory alignment is limited" );
+		return static_cast< Type * >( allocateFrame( count * sizeof( Type ), alignof( Type ) > DEFAULT_ALIGNMENT ? alignof( Type ) : DEFAULT_ALIGNMENT ) );
+	}
+
+
+	std::size_t getFrameArenaSize();
+
+	// All operator new calls of the process, and those the guard caught during frames after warm-up
+	std::size_t getHeapAllocationCount();
+	std::size_t getGuardedAllocationCount();
+
+
+	// Allocations of the current thread inside the scope are expected, the guard ignores them
+	class HeapScope
+	{
+	public:
+		HeapScope();
+		~HeapScope();
+
+		HeapScope( HeapScope const & ) = delete;
+		HeapScope &operator = ( HeapScope const & ) = delete;
+	};
+}
@@ -0,0 +1,79 @@
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "options.hpp"
+
+
+namespace
+{
+	std::vector< std::pair< std::string, std::string > > values;
+
+
+	//-------------------------------------------------------
+	std::pair< std::string, std::string > const *find( char const *name )
+	{
+		for ( auto const &value : values )
+			if ( value.first == name )
+				return &value;
+		return nullptr;
+	}
+}
+
+
+namespace options
+{
+	void parse( int argc, char **argv )
+	{
+		values.clear();
+		for ( int i = 1; i < argc; ++i )
+		{
+			if ( std::strncmp( argv[ i ], "--", 2 ) != 0 )
+				continue;
+
+			std::string name = argv[ i ] + 2;
+			std::string value;
+			size_t separator = name.find( '=' );
+			if ( separator != std::string::npos )
+			{
+				value = name.substr( separator + 1 );
+				name.resize( separator );
+			}
+			else if ( i + 1 < argc && std::strncmp( argv[ i + 1 ], "--", 2 ) != 0 )
+			{
+				value = argv[ ++i ];
+			}
+			values.emplace_back( name, value );
+		}
+	}
+
+
+	bool has( char const *name )
+	{
+		return find( name ) != nullptr;
+	}
+
+
+	int getInt( char const *name, int defaultValue )
+	{
+		auto value = find( name );
+		return value && !value->second.empty() ? std::atoi( value->second.c_str() ) : defaultValue;
+	}
+
+
+	float getFloat( char const *name, float defaultValue )
+	{
+		auto value = find( name );
+		return value && !value->second.empty() ? ( float )std::atof( value->second.c_str() ) : defaultValue;
+	}
+
+
+	char const *getString( char const *name, char const *defaultValue )
+	{
+		auto value = find( name );
+		return value ? value->second.c_str() : defaultValue;
+	}
+}
@@ -0,0 +1,17 @@
+
+
+//-------------------------------------------------------
+//	command line options
+//-------------------------------------------------------
+
+// Options are given as "--name value", "--name=value" or just "--name" for flags
+
+namespace options
+{
+	void parse( int argc, char **argv );
+
+	bool has( char const *name );
+	int getInt( char const *name, int defaultValue );
+	float getFloat( char const *name, float defaultValue );
+	char const *getString( char const *name, char const *defaultValue );
+}
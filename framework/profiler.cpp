@@ -0,0 +1,346 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <chrono>
+#endif
+
+#include "memory.hpp"
+#include "profiler.hpp"
+
+
+//-------------------------------------------------------
+//	clock
+//-------------------------------------------------------
+
+namespace
+{
+	double tickFrequency = 0.0;
+
+
+	//-------------------------------------------------------
+	void initTicks()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER frequency;
+		QueryPerformanceFrequency( &frequency );
+		tickFrequency = ( double )frequency.QuadPart;
+#else
+		tickFrequency = ( double )std::chrono::steady_clock::period::den / std::chrono::steady_clock::period::num;
+#endif
+	}
+}
+
+
+//-------------------------------------------------------
+//	scope samples
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr int MAX_SCOPES = 64;
+	constexpr char const *FRAME_SCOPE_NAME = "frame";
+
+
+	struct ScopeData
+	{
+		char const *name = nullptr;
+		std::atomic< std::int64_t > frameTicks{ 0 };	// summed over all threads during the current frame
+		float history[ profiler::HISTORY_SIZE ] = {};
+	};
+
+
+	ScopeData scopes[ MAX_SCOPES ];
+	std::atomic< int > scopeCount{ 0 };
+	std::mutex scopeMutex;
+
+	int historyIndex = 0;
+	int historyCount = 0;
+	std::int64_t frameBeginTicks = 0;
+
+
+	//-------------------------------------------------------
+	int registerScope( char const *name )
+	{
+		std::lock_guard< std::mutex > lock( scopeMutex );
+		int count = scopeCount.load( std::memory_order_relaxed );
+		for ( int i = 0; i < count; ++i )
+			if ( std::strcmp( scopes[ i ].name, name ) == 0 )
+				return i;
+
+		assert( count < MAX_SCOPES && "too many profiler scopes" );
+		if ( count == MAX_SCOPES )
+			return MAX_SCOPES - 1;
+
+		scopes[ count ].name = name;
+		scopeCount.store( count + 1, std::memory_order_release );
+		return count;
+	}
+
+
+	// Scope 0 is always the frame itself
+	int const frameScope = registerScope( FRAME_SCOPE_NAME );
+}
+
+
+//-------------------------------------------------------
+//	trace capture
+//-------------------------------------------------------
+
+namespace
+{
+	struct TraceEvent
+	{
+		int scope;
+		std::int64_t begin;
+		std::int64_t end;
+	};
+
+
+	// Every thread appends to its own buffer, buffers are only read when no scopes are running
+	struct ThreadTrace
+	{
+		int id;
+		std::vector< TraceEvent > events;
+	};
+
+
+	std::mutex traceMutex;
+	std::vector< std::unique_ptr< ThreadTrace > > threadTraces;
+	thread_local ThreadTrace *threadTrace = nullptr;
+
+	std::atomic< bool > capturing{ false };
+	std::string tracePath;
+	int traceFramesLeft = 0;
+	std::int64_t traceBeginTicks = 0;
+
+
+	//-------------------------------------------------------
+	ThreadTrace &getThreadTrace()
+	{
+		if ( !threadTrace )
+		{
+			std::lock_guard< std::mutex > lock( traceMutex );
+			threadTraces.emplace_back( new ThreadTrace );
+			threadTrace = threadTraces.back().get();
+			threadTrace->id = ( int )threadTraces.size() - 1;
+		}
+		return *threadTrace;
+	}
+
+
+	//-------------------------------------------------------
+	void writeTrace()
+	{
+		FILE *file = std::fopen( tracePath.c_str(), "w" );
+		if ( !file )
+		{
+			std::fprintf( stderr, "profiler: can't write trace to %s\n", tracePath.c_str() );
+			return;
+		}
+
+		// Chrome trace event format: complete events ("X") with microsecond timestamps
+		double toMicroseconds = 1e6 / tickFrequency;
+		char const *separator = "";
+		std::fprintf( file, "{\"traceEvents\":[\n" );
+		for ( std::unique_ptr< ThreadTrace > const &thread : threadTraces )
+		{
+			std::fprintf( file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":\"%s %d\"}}",
+						  separator, thread->id, thread->id == 0 ? "main" : "thread", thread->id );
+			separator = ",\n";
+
+			for ( TraceEvent const &event : thread->events )
+				std::fprintf( file, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+							  scopes[ event.scope ].name, thread->id,
+							  ( event.begin - traceBeginTicks ) * toMicroseconds, ( event.end - event.begin ) * toMicroseconds );
+		}
+		std::fprintf( file, "\n]}\n" );
+		std::fclose( file );
+	}
+}
+
+
+//-------------------------------------------------------
+//	public profiler interface
+//-------------------------------------------------------
+
+namespace profiler
+{
+	namespace detail
+	{
+		std::atomic< bool > enabled{ false };
+	}
+
+
+	//-------------------------------------------------------
+	ScopeInfo::ScopeInfo( char const *name ) :
+		name( name ),
+		index( registerScope( name ) )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void init( bool enabled, char const *path, int traceFrames )
+	{
+		initTicks();
+
+		// The calling thread is the main one, it gets the first trace buffer
+		getThreadTrace();
+		frameBeginTicks = getTicks();
+
+		if ( path && traceFrames > 0 )
+		{
+			tracePath = path;
+			traceFramesLeft = traceFrames;
+			traceBeginTicks = frameBeginTicks;
+			for ( std::unique_ptr< ThreadTrace > const &thread : threadTraces )
+				thread->events.reserve( 1024 );
+			capturing.store( true );
+			enabled = true;
+		}
+		setEnabled( enabled );
+	}
+
+
+	//-------------------------------------------------------
+	void deinit()
+	{
+		setEnabled( false );
+		capturing.store( false );
+		if ( !tracePath.empty() )
+			writeTrace();
+		tracePath.clear();
+
+		// Buffers stay registered, threads keep pointers to them
+		for ( std::unique_ptr< ThreadTrace > const &thread : threadTraces )
+			thread->events.clear();
+	}
+
+
+	//-------------------------------------------------------
+	void setEnabled( bool enabled )
+	{
+		detail::enabled.store( enabled, std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	bool isEnabled()
+	{
+		return detail::enabled.load( std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	void endFrame( double frameTime )
+	{
+		std::int64_t frameEndTicks = getTicks();
+		if ( isEnabled() )
+		{
+			if ( capturing.load( std::memory_order_relaxed ) )
+			{
+				// The capture is a diagnostic, its buffers may grow during frames
+				memory::HeapScope heapScope;
+				getThreadTrace().events.push_back( TraceEvent{ frameScope, frameBeginTicks, frameEndTicks } );
+				if ( --traceFramesLeft == 0 )
+					capturing.store( false );
+			}
+
+			int count = scopeCount.load( std::memory_order_acquire );
+			scopes[ frameScope ].history[ historyIndex ] = ( float )frameTime;
+			for ( int i = 0; i < count; ++i )
+			{
+				if ( i == frameScope )
+					continue;
+				std::int64_t ticks = scopes[ i ].frameTicks.exchange( 0, std::memory_order_relaxed );
+				scopes[ i ].history[ historyIndex ] = ( float )( ticks / tickFrequency );
+			}
+			historyIndex = ( historyIndex + 1 ) % HISTORY_SIZE;
+			historyCount = std::min( historyCount + 1, HISTORY_SIZE );
+		}
+		frameBeginTicks = frameEndTicks;
+	}
+
+
+	//-------------------------------------------------------
+	int getScopeCount()
+	{
+		return scopeCount.load( std::memory_order_acquire );
+	}
+
+
+	//-------------------------------------------------------
+	char const *getScopeName( int scope )
+	{
+		assert( scope >= 0 && scope < getScopeCount() );
+		return scopes[ scope ].name;
+	}
+
+
+	//-------------------------------------------------------
+	Statistics getStatistics( int scope )
+	{
+		assert( scope >= 0 && scope < getScopeCount() );
+		Statistics statistics;
+		if ( historyCount == 0 )
+			return statistics;
+
+		float samples[ HISTORY_SIZE ];
+		std::copy( scopes[ scope ].history, scopes[ scope ].history + historyCount, samples );
+		std::sort( samples, samples + historyCount );
+
+		double sum = 0.0;
+		for ( int i = 0; i < historyCount; ++i )
+			sum += samples[ i ];
+
+		int p99Index = std::max( ( int )std::ceil( historyCount * 0.99 ) - 1, 0 );
+		statistics.min = samples[ 0 ];
+		statistics.average = sum / historyCount;
+		statistics.p99 = samples[ p99Index ];
+		statistics.last = scopes[ scope ].history[ ( historyIndex + HISTORY_SIZE - 1 ) % HISTORY_SIZE ];
+		statistics.count = historyCount;
+		return statistics;
+	}
+
+
+	//-------------------------------------------------------
+	std::int64_t getTicks()
+	{
+#ifdef _WIN32
+		LARGE_INTEGER ticks;
+		QueryPerformanceCounter( &ticks );
+		return ticks.QuadPart;
+#else
+		return std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+	}
+
+
+	//-------------------------------------------------------
+	double getTickFrequency()
+	{
+		return tickFrequency;
+	}
+
+
+	//-------------------------------------------------------
+	void addScopeTime( ScopeInfo const &info, std::int64_t begin, std::int64_t end )
+	{
+		scopes[ info.index ].frameTicks.fetch_add( end - begin, std::memory_order_relaxed );
+		if ( capturing.load( std::memory_order_relaxed ) )
+		{
+			memory::HeapScope heapScope;
+			getThreadTrace().events.push_back( TraceEvent{ info.index, begin, end } );
+		}
+	}
+}
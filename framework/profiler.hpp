@@ -0,0 +1,101 @@
+//-------------------------------------------------------
+//	frame profiler
+//-------------------------------------------------------
+
+/*
+ * Scoped timers for the engine subsystems: PROFILE_SCOPE( "name" ) measures the rest of the enclosing block
+ * Times of a scope are summed per frame and kept in a ring buffer of the last HISTORY_SIZE frames
+ * While a trace capture is running, every scope is also recorded as a Chrome trace event
+ * (chrome://tracing, Perfetto), the capture is written by deinit()
+ *
+ * When the profiler is disabled, a scope costs one relaxed atomic load
+ */
+
+#include <atomic>
+#include <cstdint>
+
+
+namespace profiler
+{
+	constexpr int HISTORY_SIZE = 256;
+
+	// Registered once per PROFILE_SCOPE site, scopes with the same name share the samples
+	struct ScopeInfo
+	{
+		explicit ScopeInfo( char const *name );
+
+		char const *name;
+		int index;
+	};
+
+
+	// Frame statistics in seconds, over the frames in the ring buffer
+	struct Statistics
+	{
+		double min = 0.0;
+		double average = 0.0;
+		double p99 = 0.0;
+		double last = 0.0;
+		int count = 0;
+	};
+
+
+	// Trace capture starts with the first frame and stops after traceFrames, 0 doesn't capture
+	void init( bool enabled, char const *tracePath = nullptr, int traceFrames = 0 );
+	void deinit();
+
+	void setEnabled( bool enabled );
+	bool isEnabled();
+
+	// Closes the current frame: collects the scope times of the frame, frameTime is the whole frame duration
+	// Must not run concurrently with scopes of the frame
+	void endFrame( double frameTime );
+
+	// Frame duration is reported as scope 0, "frame"
+	int getScopeCount();
+	char const *getScopeName( int scope );
+	Statistics getStatistics( int scope );
+
+	std::int64_t getTicks();
+	double getTickFrequency();
+
+	void addScopeTime( ScopeInfo const &info, std::int64_t begin, std::int64_t end );
+
+
+	namespace detail
+	{
+		extern std::atomic< bool > enabled;
+	}
+
+
+	class Scope
+	{
+	public:
+		explicit Scope( ScopeInfo const &info ) :
+			info( detail::enabled.load( std::memory_order_relaxed ) ? &info : nullptr ),
+			begin( this->info ? getTicks() : 0 )
+		{
+		}
+
+		~Scope()
+		{
+			if ( info )
+				addScopeTime( *info, begin, getTicks() );
+		}
+
+		Scope( Scope const & ) = delete;
+		Scope &operator = ( Scope const & ) = delete;
+
+	private:
+		ScopeInfo const *info;
+		std::int64_t begin;
+	};
+}
+
+
+#define PROFILE_CONCAT_IMPL( a, b ) a##b
+#define PROFILE_CONCAT( a, b ) PROFILE_CONCAT_IMPL( a, b )
+
+#define PROFILE_SCOPE( name ) \
+	static profiler::ScopeInfo const PROFILE_CONCAT( profileScopeInfo, __LINE__ )( name ); \
+	profiler::Scope PROFILE_CONCAT( profileScope, __LINE__ )( PROFILE_CONCAT( profileScopeInfo, __LINE__ ) )
@@ -0,0 +1,112 @@
+//-------------------------------------------------------
+//	fast pseudo random numbers
+//-------------------------------------------------------
+
+/*
+ * Batched uniform floats for effects, which need plenty of cheap numbers and no statistical rigor
+ *
+ * A generator runs LANE_COUNT independent xorshift32 streams side by side, every call fills its output
+ * lane by lane: the lanes only need 32 bit shifts and xors, so the compiler keeps them in one vector register
+ * The output only depends on the seed and the counts of the calls, the same on every platform
+ */
+
+#include <cstdint>
+
+
+namespace prng
+{
+	constexpr int LANE_COUNT = 4;
+
+
+	class Generator
+	{
+	public:
+		explicit Generator( std::uint32_t seed );
+
+		// Fills count values uniform between min and max
+		void fill( float *values, int count, float min, float max );
+
+		// The lane states as they are, a stream continues from a restored state as it would have from the saved one
+		void getState( std::uint32_t *lanes ) const;
+		void setState( std::uint32_t const *lanes );
+
+	private:
+		std::uint32_t nextBits( int lane );
+
+		std::uint32_t state[ LANE_COUNT ];
+	};
+
+
+	//-------------------------------------------------------
+	inline Generator::Generator( std::uint32_t seed )
+	{
+		// Splitmix finalizer, nearby seeds still give unrelated lanes. xorshift never leaves a zero state
+		for ( int lane = 0; lane < LANE_COUNT; ++lane )
+		{
+			std::uint32_t bits = seed + ( lane + 1 ) * 0x9e3779b9u;
+			bits = ( bits ^ ( bits >> 16 ) ) * 0x85ebca6bu;
+			bits = ( bits ^ ( bits >> 13 ) ) * 0xc2b2ae35u;
+			bits ^= bits >> 16;
+			state[ lane ] = bits != 0 ? bits : 1;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	inline void Generator::getState( std::uint32_t *lanes ) const
+	{
+		for ( int lane = 0; lane < LANE_COUNT; ++lane )
+			lanes[ lane ] = state[ lane ];
+	}
+
+
+	//-------------------------------------------------------
+	inline void Generator::setState( std::uint32_t const *lanes )
+	{
+		// A zero lane would stay zero forever, no saved state has one
+		for ( int lane = 0; lane < LANE_COUNT; ++lane )
+			state[ lane ] = lanes[ lane ] != 0 ? lanes[ lane ] : 1;
+	}
+
+
+	//-------------------------------------------------------
+	inline std::uint32_t Generator::nextBits( int lane )
+	{
+		std::uint32_t bits = state[ lane ];
+		bits ^= bits << 13;
+		bits ^= bits >> 17;
+		bits ^= bits << 5;
+		state[ lane ] = bits;
+		return bits;
+	}
+
+
+	//-------------------------------------------------------
+	inline void Generator::fill( float *values, int count, float min, float max )
+	{
+		// The top 24 bits are exact in a float, and fit an int for the signed conversion SSE2 has
+		float scale = ( max - min ) * ( 1.f / 16777216.f );
+		std::uint32_t lanes[ LANE_COUNT ];
+		for ( int lane = 0; lane < LANE_COUNT; ++lane )
+			lanes[ lane ] = state[ lane ];
+
+		int i = 0;
+		for ( ; i + LANE_COUNT <= count; i += LANE_COUNT )
+		{
+			for ( int lane = 0; lane < LANE_COUNT; ++lane )
+			{
+				std::uint32_t bits = lanes[ lane ];
+				bits ^= bits << 13;
+				bits ^= bits >> 17;
+				bits ^= bits << 5;
+				lanes[ lane ] = bits;
+				values[ i + lane ] = min + scale * ( float )( std::int32_t )( bits >> 8 );
+			}
+		}
+
+		for ( int lane = 0; lane < LANE_COUNT; ++lane )
+			state[ lane ] = lanes[ lane ];
+		for ( int lane = 0; i < count; ++i, ++lane )
+			values[ i ] = min + scale * ( float )( std::int32_t )( nextBits( lane ) >> 8 );
+	}
+}
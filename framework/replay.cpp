@@ -0,0 +1,322 @@
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+
+#include "game.hpp"
+#include "input.hpp"
+#include "memory.hpp"
+#include "replay.hpp"
+#include "scene.hpp"
+
+
+//-------------------------------------------------------
+//	log format
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr std::uint32_t LOG_MAGIC = 0x4c505257;	// "WRPL"
+	constexpr std::uint32_t LOG_VERSION = 3;
+
+	// The first version, which has step records
+	constexpr std::uint32_t STEP_LOG_VERSION = 3;
+
+
+	enum RecordType : std::uint8_t
+	{
+		RECORD_FRAME,
+		RECORD_KEY_DOWN,
+		RECORD_KEY_UP,
+		RECORD_CLICK,
+		RECORD_RESTART,
+		RECORD_CAMERA,
+		RECORD_STEP
+	};
+
+
+	FILE *logFile = nullptr;
+	bool recording = false;
+	bool replaying = false;
+	std::uint32_t logVersion = 0;
+	int frameIndex = 0;
+
+
+	//-------------------------------------------------------
+	template< class Value >
+	void write( Value const &value )
+	{
+		std::fwrite( &value, sizeof( value ), 1, logFile );
+	}
+
+
+	//-------------------------------------------------------
+	template< class Value >
+	bool read( Value *value )
+	{
+		return std::fread( value, sizeof( *value ), 1, logFile ) == 1;
+	}
+
+
+	//-------------------------------------------------------
+	void applyEvent( input::Event const &event )
+	{
+		switch ( event.type )
+		{
+			case input::EVENT_KEY_DOWN:
+				game::keyPressed( event.key );
+				break;
+
+			case input::EVENT_KEY_UP:
+				game::keyReleased( event.key );
+				break;
+
+			case input::EVENT_CLICK:
+				game::mouseClicked( event.x, event.y, event.isLeftButton );
+				break;
+
+			case input::EVENT_RESTART:
+				memory::beginWarmup();
+				game::deinit();
+				game::init();
+				break;
+
+			case input::EVENT_CAMERA:
+				scene::setCamera( event.x, event.y, event.zoom );
+				break;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void writeEvent( input::Event const &event )
+	{
+		switch ( event.type )
+		{
+			case input::EVENT_KEY_DOWN:
+				write( RECORD_KEY_DOWN );
+				write( event.key );
+				break;
+
+			case input::EVENT_KEY_UP:
+				write( RECORD_KEY_UP );
+				write( event.key );
+				break;
+
+			case input::EVENT_CLICK:
+				write( RECORD_CLICK );
+				write( event.x );
+				write( event.y );
+				write( ( std::uint8_t )event.isLeftButton );
+				break;
+
+			case input::EVENT_RESTART:
+				write( RECORD_RESTART );
+				break;
+
+			case input::EVENT_CAMERA:
+				write( RECORD_CAMERA );
+				write( event.x );
+				write( event.y );
+				write( event.zoom );
+				break;
+		}
+	}
+
+
+	//-------------------------------------------------------
+	// Applies input records until the record of the frame or the step they belong to, dt is read from a frame record
+	bool playRecords( RecordType until, float *dt )
+	{
+		std::uint8_t type;
+		while ( read( &type ) )
+		{
+			input::Event event = {};
+			std::uint8_t isLeftButton;
+			std::uint32_t index;
+			bool complete = true;
+			switch ( type )
+			{
+				case RECORD_FRAME:
+					if ( until != RECORD_FRAME )
+						break;
+					if ( !read( &index ) || !read( dt ) )
+						return false;
+					assert( index == ( std::uint32_t )frameIndex );
+					++frameIndex;
+					return true;
+
+				case RECORD_STEP:
+					if ( until != RECORD_STEP )
+						break;
+					return true;
+
+				case RECORD_KEY_DOWN:
+					event.type = input::EVENT_KEY_DOWN;
+					complete = read( &event.key );
+					break;
+
+				case RECORD_KEY_UP:
+					event.type = input::EVENT_KEY_UP;
+					complete = read( &event.key );
+					break;
+
+				case RECORD_CLICK:
+					event.type = input::EVENT_CLICK;
+					complete = read( &event.x ) && read( &event.y ) && read( &isLeftButton );
+					event.isLeftButton = isLeftButton != 0;
+					break;
+
+				case RECORD_RESTART:
+					event.type = input::EVENT_RESTART;
+					break;
+
+				case RECORD_CAMERA:
+					event.type = input::EVENT_CAMERA;
+					complete = read( &event.x ) && read( &event.y ) && read( &event.zoom );
+					break;
+
+				default:
+					complete = false;
+					break;
+			}
+
+			// A frame record inside a step, or a step record before a frame one break the log too
+			if ( !complete || type == RECORD_FRAME || type == RECORD_STEP )
+			{
+				std::fprintf( stderr, "replay: broken log at frame %d\n", frameIndex );
+				return false;
+			}
+			applyEvent( event );
+		}
+		return false;
+	}
+}
+
+
+//-------------------------------------------------------
+//	public replay interface
+//-------------------------------------------------------
+
+namespace replay
+{
+	//-------------------------------------------------------
+	bool startRecording( char const *path )
+	{
+		stop();
+		logFile = std::fopen( path, "wb" );
+		if ( !logFile )
+		{
+			std::fprintf( stderr, "replay: can't write %s\n", path );
+			return false;
+		}
+
+		write( LOG_MAGIC );
+		write( LOG_VERSION );
+		recording = true;
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	bool startReplay( char const *path )
+	{
+		stop();
+		logFile = std::fopen( path, "rb" );
+		if ( !logFile )
+		{
+			std::fprintf( stderr, "replay: can't read %s\n", path );
+			return false;
+		}
+
+		std::uint32_t magic = 0;
+		std::uint32_t version = 0;
+		// Version 1 logs only lack the camera records
+		if ( !read( &magic ) || !read( &version ) || magic != LOG_MAGIC || version < 1 || version > LOG_VERSION )
+		{
+			std::fprintf( stderr, "replay: %s is not a replay log of version %u or older\n", path, LOG_VERSION );
+			stop();
+			return false;
+		}
+
+		logVersion = version;
+		replaying = true;
+		return true;
+	}
+
+
+	//-------------------------------------------------------
+	void stop()
+	{
+		if ( logFile )
+			std::fclose( logFile );
+		logFile = nullptr;
+		recording = false;
+		replaying = false;
+		frameIndex = 0;
+	}
+
+
+	//-------------------------------------------------------
+	bool isRecording()
+	{
+		return recording;
+	}
+
+
+	//-------------------------------------------------------
+	bool isReplaying()
+	{
+		return replaying;
+	}
+
+
+	//-------------------------------------------------------
+	void recordFrame( float dt )
+	{
+		if ( !recording )
+			return;
+		write( RECORD_FRAME );
+		write( ( std::uint32_t )frameIndex );
+		write( dt );
+		++frameIndex;
+	}
+
+
+	//-------------------------------------------------------
+	bool playFrame( float *dt )
+	{
+		return replaying && playRecords( RECORD_FRAME, dt );
+	}
+
+
+	//-------------------------------------------------------
+	void dispatchInput()
+	{
+		input::Event event;
+		if ( replaying )
+		{
+			while ( input::pop( &event ) )
+				;
+			// Older logs apply the input of a frame in playFrame
+			if ( logVersion >= STEP_LOG_VERSION )
+				playRecords( RECORD_STEP, nullptr );
+			return;
+		}
+
+		while ( input::pop( &event ) )
+		{
+			if ( recording )
+				writeEvent( event );
+			applyEvent( event );
+		}
+		if ( recording )
+			write( RECORD_STEP );
+	}
+
+
+	//-------------------------------------------------------
+	int getFrameIndex()
+	{
+		return frameIndex;
+	}
+}
@@ -0,0 +1,49 @@
+//-------------------------------------------------------
+//	input recording and replay
+//-------------------------------------------------------
+
+/*
+ * All game input goes through the input queue, dispatchInput drains it at the start of every simulation step,
+ * forwards the events to game:: and, while recording, appends them to a compact binary log together
+ * with the dt of every frame and the step boundaries
+ * Replay feeds the log back through the same game:: entry points with the recorded dt and at the recorded
+ * steps, so a replayed run simulates exactly the recorded frames, headless or windowed
+ * The camera is recorded too, clicks are mapped to the world through it
+ * Game options (--carriers, --aircraft, --goals, --snapshot, --tick-rate) are not recorded, a log is replayed with the same ones
+ *
+ * Log layout, host byte order: header { uint32 magic "WRPL", uint32 version } followed by records
+ * of a uint8 type and its payload. Since version 3 the frame record comes first, then the input records
+ * of every step of the frame, each step closed by a STEP record. Before, input records of a frame came
+ * before the frame record and were applied at the start of the frame:
+ *	FRAME		uint32 frame index, float dt
+ *	KEY_DOWN	uint8 key
+ *	KEY_UP		uint8 key
+ *	CLICK		float x, float y, uint8 isLeftButton
+ *	RESTART		no payload, game::deinit and game::init
+ *	CAMERA		float x, float y, float zoom, since version 2
+ *	STEP		no payload, since version 3
+ */
+
+namespace replay
+{
+	bool startRecording( char const *path );
+	bool startReplay( char const *path );
+	void stop();
+
+	bool isRecording();
+	bool isReplaying();
+
+	// Opens the recorded frame, to be called once per frame before the frame is simulated
+	void recordFrame( float dt );
+
+	// Reads the next replayed frame and returns its dt, false at the end of the log
+	bool playFrame( float *dt );
+
+	// To be called at the start of every simulation step: applies the queued live input and records it,
+	// or the input of the next replayed step. Live input is dropped while replaying, the log is the only
+	// input source then
+	void dispatchInput();
+
+	// Frames recorded or replayed so far
+	int getFrameIndex();
+}
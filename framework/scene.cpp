@@ -1,13 +1,27 @@
 
+#ifndef WOTS_HEADLESS
 #include <windows.h>
 #include <GL/gl.h>
+#endif
 
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
 #include <vector>
 #include <algorithm>
-#include <random>
-
+#include <tuple>
+#include <type_traits>
+
+#include "fastmath.hpp"
+#include "glext.hpp"
+#include "jobs.hpp"
+#include "profiler.hpp"
+#include "random.hpp"
 #include "scene.hpp"
+#include "streambuffer.hpp"
+#include "telemetry.hpp"
 
 
 namespace scene
@@ -17,6 +31,61 @@ namespace scene
 }
 
 
+namespace
+{
+	constexpr float PI = 3.14159265f;
+}
+
+
+//-------------------------------------------------------
+//	camera and view culling
+//-------------------------------------------------------
+
+namespace
+{
+	struct Camera
+	{
+		float x;
+		float y;
+		float zoom;
+	};
+
+
+	// World rectangle seen through the camera and its screen scale, for culling and the level of detail
+	struct View
+	{
+		float minX;
+		float minY;
+		float maxX;
+		float maxY;
+		float pixelsPerUnit;
+
+		bool contains( float x, float y, float radius ) const
+		{
+			return x + radius >= minX && x - radius <= maxX && y + radius >= minY && y - radius <= maxY;
+		}
+	};
+
+
+	Camera camera = { 0.f, 0.f, 1.f };
+	Camera publishedCamera = camera;
+
+	// The window size of the engine, until it reports its own
+	int viewportWidth = 1024;
+	int viewportHeight = 768;
+
+
+	//-------------------------------------------------------
+	View getView( Camera const &camera )
+	{
+		float halfWidth = 0.5f * scene::VIEW_WIDTH / camera.zoom;
+		float halfHeight = 0.5f * scene::VIEW_HEIGHT / camera.zoom;
+		float pixelsPerUnit = std::min( viewportWidth / scene::VIEW_WIDTH, viewportHeight / scene::VIEW_HEIGHT ) * camera.zoom;
+		return View{ camera.x - halfWidth, camera.y - halfHeight, camera.x + halfWidth, camera.y + halfHeight, pixelsPerUnit };
+	}
+}
+
+
 //-------------------------------------------------------
 //	simple particles support
 //-------------------------------------------------------
@@ -29,187 +98,1015 @@ namespace
 	};
 
 
-	struct Particle
+	struct Vertex
 	{
 		float x;
 		float y;
-		float life;
-		Color color;
 	};
 
 
-	std::vector< Particle > particles;
+	// A float clock has a 0.1 ms resolution up to here
+	constexpr float CLOCK_REBASE_TIME = 1024.f;
+
+
+	// Fixed capacity particle storage in structure-of-arrays layout.
+	// All particles of a pool get the same life time, so they expire in spawn order and the
+	// pool is a plain ring buffer: expiry only advances the head, and spawning into a full
+	// pool overwrites the oldest particle instead of growing.
+	// Particles keep their birth time on the pool clock instead of a life counter: an update
+	// advances the clock and searches the sorted birth times for the first alive particle,
+	// nothing is written per particle.
+	class ParticlePool
+	{
+	public:
+		ParticlePool( int capacity, float lifeTime );
+
+		// Spawns count particles at once, generate( x, y, n ) writes the positions of n of them
+		// straight into the pool, it's called once for every contiguous part of the ring
+		template < class Generate >
+		void spawn( int count, Color color, Generate generate );
+
+		void update( float dt );
+
+		// Grows the storage to hold at least that many particles, alive particles are kept
+		void reserve( int newCapacity );
+
+		int getCapacity() const { return capacity; }
+		int getSize() const { return size; }
+
+		// Appends alive particles inside the view to the given arrays, oldest first, returns their count
+		int gather( View const &view, Vertex *vertices, Color *colors ) const;
+
+	private:
+		int getTail() const;
+		void rebaseClock();
+
+		int capacity;
+		float lifeTime;
+
+		int head = 0;
+		int size = 0;
+		float clock = 0.f;
+
+		std::vector< float > x;
+		std::vector< float > y;
+		std::vector< float > birth;
+		std::vector< Color > color;
+	};
+
+
+	//-------------------------------------------------------
+	ParticlePool::ParticlePool( int capacity, float lifeTime ) :
+		capacity( capacity ),
+		lifeTime( lifeTime ),
+		x( capacity ),
+		y( capacity ),
+		birth( capacity ),
+		color( capacity )
+	{
+	}
 
 
-	void addParticle( float x, float y, float life, Color color )
+	//-------------------------------------------------------
+	int ParticlePool::getTail() const
 	{
-		Particle particle = { x, y, life, color };
-		particles.push_back( particle );
+		int tail = head + size;
+		return tail >= capacity ? tail - capacity : tail;
 	}
 
 
-	void updateParticles( float dt )
+	//-------------------------------------------------------
+	template < class Generate >
+	void ParticlePool::spawn( int count, Color pcolor, Generate generate )
+	{
+		// Only the last capacity particles would survive
+		count = std::min( count, capacity );
+		int tail = getTail();
+		int spawned = 0;
+		while ( spawned < count )
+		{
+			int partCount = std::min( count - spawned, capacity - tail );
+			generate( x.data() + tail, y.data() + tail, partCount );
+			std::fill_n( birth.data() + tail, partCount, clock );
+			std::fill_n( color.data() + tail, partCount, pcolor );
+			spawned += partCount;
+			tail += partCount;
+			if ( tail == capacity )
+				tail = 0;
+		}
+
+		int overwritten = std::max( size + count - capacity, 0 );
+		size += count - overwritten;
+		head += overwritten;
+		if ( head >= capacity )
+			head -= capacity;
+	}
+
+
+	//-------------------------------------------------------
+	void ParticlePool::update( float dt )
 	{
-		for ( Particle &particle : particles )
-			particle.life -= dt;
-		auto newEnd = std::remove_if( particles.begin(), particles.end(), []( Particle &particle ){ return particle.life <= 0.f; } );
-		particles.erase( newEnd, particles.end() );
+		clock += dt;
+
+		// Birth times grow along the ring from the head, the first part runs to the end of the storage
+		float expiredBirth = clock - lifeTime;
+		int firstCount = std::min( size, capacity - head );
+		float const *births = birth.data();
+		int expired = int( std::upper_bound( births + head, births + head + firstCount, expiredBirth ) - ( births + head ) );
+		if ( expired == firstCount )
+			expired += int( std::upper_bound( births, births + size - firstCount, expiredBirth ) - births );
+
+		size -= expired;
+		head += expired;
+		if ( head >= capacity )
+			head -= capacity;
+
+		if ( clock >= CLOCK_REBASE_TIME )
+			rebaseClock();
 	}
 
 
+	//-------------------------------------------------------
+	void ParticlePool::reserve( int newCapacity )
+	{
+		if ( newCapacity <= capacity )
+			return;
+
+		// The alive particles are unrolled to the start of the new storage, oldest first
+		auto grow = [ this, newCapacity ]( auto &values )
+		{
+			typename std::remove_reference< decltype( values ) >::type grown( newCapacity );
+			int firstCount = std::min( size, capacity - head );
+			std::copy_n( values.data() + head, firstCount, grown.data() );
+			std::copy_n( values.data(), size - firstCount, grown.data() + firstCount );
+			values.swap( grown );
+		};
+		grow( x );
+		grow( y );
+		grow( birth );
+		grow( color );
+		capacity = newCapacity;
+		head = 0;
+	}
+
+
+	//-------------------------------------------------------
+	void ParticlePool::rebaseClock()
+	{
+		// Keeps the clock small, so birth times stay precise in long sessions
+		int firstCount = std::min( size, capacity - head );
+		float *births = birth.data();
+		for ( int i = head; i < head + firstCount; ++i )
+			births[ i ] -= clock;
+		for ( int i = 0; i < size - firstCount; ++i )
+			births[ i ] -= clock;
+		clock = 0.f;
+	}
+
+
+	//-------------------------------------------------------
+	int ParticlePool::gather( View const &view, Vertex *vertices, Color *colors ) const
+	{
+		int count = 0;
+		int index = head;
+		for ( int i = 0; i < size; ++i )
+		{
+			if ( view.contains( x[ index ], y[ index ], 0.f ) )
+			{
+				vertices[ count ].x = x[ index ];
+				vertices[ count ].y = y[ index ];
+				colors[ count ] = color[ index ];
+				++count;
+			}
+			if ( ++index == capacity )
+				index = 0;
+		}
+		return count;
+	}
+
+
+	//-------------------------------------------------------
+	// Aircrafts emit a trail particle every TRAIL_INTERVAL at most, reserveMeshes sizes the trail pool
+	// for the alive trails of all aircrafts: the ones of the life time and the one replacing the oldest
+	constexpr float TRAIL_LIFE_TIME = 0.8f;
+	constexpr float TRAIL_INTERVAL = 0.1f;
+	constexpr int TRAILS_PER_AIRCRAFT = int( TRAIL_LIFE_TIME / TRAIL_INTERVAL + 0.5f ) + 1;
+
+	ParticlePool seaParticles( 1024, 3.f );
+	ParticlePool trailParticles( 32768, TRAIL_LIFE_TIME );
+
+
+	// Trails emitted since the last update, appended to the trail pool by it. The staging has the capacity
+	// of the pool: more particles would only overwrite each other there, the extra ones are dropped
+	struct TrailStaging
+	{
+		std::vector< float > x = std::vector< float >( trailParticles.getCapacity() );
+		std::vector< float > y = std::vector< float >( trailParticles.getCapacity() );
+		int size = 0;
+	};
+
+
+	TrailStaging trailStaging;
+
+
+	//-------------------------------------------------------
+	void mergeTrails()
+	{
+		int merged = 0;
+		trailParticles.spawn( trailStaging.size, Color{ 1.f, 1.f, 1.f }, [ &merged ]( float *x, float *y, int count )
+		{
+			std::copy_n( trailStaging.x.data() + merged, count, x );
+			std::copy_n( trailStaging.y.data() + merged, count, y );
+			merged += count;
+		} );
+		trailStaging.size = 0;
+	}
+
+	// Published copy of the pools in the streaming buffer, drawn while the next frame is updated
+	struct PublishedParticles
+	{
+		streambuffer::Range vertices;
+		streambuffer::Range colors;
+		int count;
+	};
+
+
+	PublishedParticles publishedParticles = {};
+
+
+	//-------------------------------------------------------
+	std::size_t getParticleBytes()
+	{
+		std::size_t count = seaParticles.getSize() + trailParticles.getSize();
+		return streambuffer::getAllocationSize( count * sizeof( Vertex ) ) + streambuffer::getAllocationSize( count * sizeof( Color ) );
+	}
+
+
+	//-------------------------------------------------------
+	void allocateParticles()
+	{
+		PublishedParticles &particles = publishedParticles;
+		int count = seaParticles.getSize() + trailParticles.getSize();
+		particles.vertices = streambuffer::allocate( count * sizeof( Vertex ) );
+		particles.colors = streambuffer::allocate( count * sizeof( Color ) );
+		particles.count = particles.vertices.data && particles.colors.data ? count : 0;
+	}
+
+
+	//-------------------------------------------------------
+	// Fills the allocated ranges with the visible particles, safe to run on a worker thread
+	void writeParticles( View const &view )
+	{
+		PublishedParticles &particles = publishedParticles;
+		if ( particles.count == 0 )
+			return;
+
+		Vertex *vertices = static_cast< Vertex * >( particles.vertices.data );
+		Color *colors = static_cast< Color * >( particles.colors.data );
+		int seaCount = seaParticles.gather( view, vertices, colors );
+		int trailCount = trailParticles.gather( view, vertices + seaCount, colors + seaCount );
+		particles.count = seaCount + trailCount;
+	}
+
+
+#ifndef WOTS_HEADLESS
 	void drawParticles()
 	{
+		PublishedParticles const &particles = publishedParticles;
+		if ( particles.count == 0 )
+			return;
+
 		glLoadIdentity();
 		glPointSize( 2.f );
-		glBegin( GL_POINTS );
-		for ( Particle const &particle : particles )
-		{
-			glColor3f( particle.color.r, particle.color.g, particle.color.b );
-			glVertex2f( particle.x, particle.y );
-		}
-		glEnd();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glEnableClientState( GL_COLOR_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, 0, streambuffer::getDrawPointer( particles.vertices.offset ) );
+		glColorPointer( 3, GL_FLOAT, 0, streambuffer::getDrawPointer( particles.colors.offset ) );
+		glDrawArrays( GL_POINTS, 0, particles.count );
+		glDisableClientState( GL_COLOR_ARRAY );
+		glDisableClientState( GL_VERTEX_ARRAY );
 	}
+#endif
 }
 
 
 //-------------------------------------------------------
-//	user interface: common mesh support
+//	batched mesh rendering
 //-------------------------------------------------------
 
-namespace scene
+namespace
+{
+	struct Instance
+	{
+		float x;
+		float y;
+
+		// Rotation of the instance, computed once when the instance is published
+		float cosAngle;
+		float sinAngle;
+	};
+
+
+	constexpr int INSTANCES_PER_JOB = 256;
+
+	// On screen radius in pixels, below which mesh instances become points
+	constexpr float POINT_RADIUS = 2.5f;
+	constexpr float MIN_POINT_SIZE = 2.f;
+
+	// Set by initDraw, publish writes only the instance placements then
+	bool instancedDraw = false;
+}
+
+
+#ifndef WOTS_HEADLESS
+//-------------------------------------------------------
+//	instanced mesh drawing
+//-------------------------------------------------------
+
+namespace
+{
+	// The system headers stop at OpenGL 1.1, the rest is declared here and loaded through glext
+	typedef std::ptrdiff_t BufferSize;
+
+	constexpr GLenum ARRAY_BUFFER = 0x8892;
+	constexpr GLenum STATIC_DRAW = 0x88E4;
+	constexpr GLenum FRAGMENT_SHADER = 0x8B30;
+	constexpr GLenum VERTEX_SHADER = 0x8B31;
+	constexpr GLenum COMPILE_STATUS = 0x8B81;
+	constexpr GLenum LINK_STATUS = 0x8B82;
+
+	constexpr GLuint VERTEX_ATTRIBUTE = 0;
+	constexpr GLuint PLACEMENT_ATTRIBUTE = 1;
+
+
+	// Only the instance placement is programmable, the matrix stacks and the current color
+	// are the fixed function state the client array path uses as well
+	char const *const MESH_VERTEX_SHADER =
+		"#version 120\n"
+		"attribute vec2 vertex;\n"
+		"attribute vec4 placement;\n"
+		"void main()\n"
+		"{\n"
+		"	vec2 rotated = vec2( placement.z * vertex.x - placement.w * vertex.y, placement.w * vertex.x + placement.z * vertex.y );\n"
+		"	gl_Position = gl_ModelViewProjectionMatrix * vec4( placement.xy + rotated, 0.0, 1.0 );\n"
+		"	gl_FrontColor = gl_Color;\n"
+		"}\n";
+
+	char const *const MESH_FRAGMENT_SHADER =
+		"#version 120\n"
+		"void main()\n"
+		"{\n"
+		"	gl_FragColor = gl_Color;\n"
+		"}\n";
+
+
+	struct InstancingFunctions
+	{
+		void ( APIENTRY *genBuffers )( GLsizei count, GLuint *buffers );
+		void ( APIENTRY *deleteBuffers )( GLsizei count, GLuint const *buffers );
+		void ( APIENTRY *bindBuffer )( GLenum target, GLuint buffer );
+		void ( APIENTRY *bufferData )( GLenum target, BufferSize size, void const *data, GLenum usage );
+		GLuint ( APIENTRY *createShader )( GLenum type );
+		void ( APIENTRY *shaderSource )( GLuint shader, GLsizei count, char const *const *strings, GLint const *lengths );
+		void ( APIENTRY *compileShader )( GLuint shader );
+		void ( APIENTRY *getShaderiv )( GLuint shader, GLenum name, GLint *value );
+		void ( APIENTRY *deleteShader )( GLuint shader );
+		GLuint ( APIENTRY *createProgram )();
+		void ( APIENTRY *attachShader )( GLuint program, GLuint shader );
+		void ( APIENTRY *bindAttribLocation )( GLuint program, GLuint index, char const *name );
+		void ( APIENTRY *linkProgram )( GLuint program );
+		void ( APIENTRY *getProgramiv )( GLuint program, GLenum name, GLint *value );
+		void ( APIENTRY *useProgram )( GLuint program );
+		void ( APIENTRY *deleteProgram )( GLuint program );
+		void ( APIENTRY *vertexAttribPointer )( GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, void const *pointer );
+		void ( APIENTRY *enableVertexAttribArray )( GLuint index );
+		void ( APIENTRY *disableVertexAttribArray )( GLuint index );
+		void ( APIENTRY *vertexAttribDivisor )( GLuint index, GLuint divisor );
+		void ( APIENTRY *drawArraysInstanced )( GLenum mode, GLint first, GLsizei count, GLsizei instanceCount );
+	};
+
+
+	InstancingFunctions gl = {};
+	GLuint meshProgram = 0;
+
+
+	//-------------------------------------------------------
+	bool loadInstancingFunctions()
+	{
+		// Buffer objects and shaders are core since OpenGL 1.5 and 2.0, their functions are just there or not
+		if ( !glext::hasExtension( "GL_ARB_instanced_arrays" ) )
+			return false;
+
+		return glext::load( &gl.genBuffers, "glGenBuffers" ) &&
+			   glext::load( &gl.deleteBuffers, "glDeleteBuffers" ) &&
+			   glext::load( &gl.bindBuffer, "glBindBuffer" ) &&
+			   glext::load( &gl.bufferData, "glBufferData" ) &&
+			   glext::load( &gl.createShader, "glCreateShader" ) &&
+			   glext::load( &gl.shaderSource, "glShaderSource" ) &&
+			   glext::load( &gl.compileShader, "glCompileShader" ) &&
+			   glext::load( &gl.getShaderiv, "glGetShaderiv" ) &&
+			   glext::load( &gl.deleteShader, "glDeleteShader" ) &&
+			   glext::load( &gl.createProgram, "glCreateProgram" ) &&
+			   glext::load( &gl.attachShader, "glAttachShader" ) &&
+			   glext::load( &gl.bindAttribLocation, "glBindAttribLocation" ) &&
+			   glext::load( &gl.linkProgram, "glLinkProgram" ) &&
+			   glext::load( &gl.getProgramiv, "glGetProgramiv" ) &&
+			   glext::load( &gl.useProgram, "glUseProgram" ) &&
+			   glext::load( &gl.deleteProgram, "glDeleteProgram" ) &&
+			   glext::load( &gl.vertexAttribPointer, "glVertexAttribPointer" ) &&
+			   glext::load( &gl.enableVertexAttribArray, "glEnableVertexAttribArray" ) &&
+			   glext::load( &gl.disableVertexAttribArray, "glDisableVertexAttribArray" ) &&
+			   glext::load( &gl.vertexAttribDivisor, "glVertexAttribDivisorARB" ) &&
+			   glext::load( &gl.drawArraysInstanced, "glDrawArraysInstancedARB" );
+	}
+
+
+	//-------------------------------------------------------
+	GLuint compileShader( GLenum type, char const *source )
+	{
+		GLuint shader = gl.createShader( type );
+		gl.shaderSource( shader, 1, &source, nullptr );
+		gl.compileShader( shader );
+
+		GLint compiled = GL_FALSE;
+		gl.getShaderiv( shader, COMPILE_STATUS, &compiled );
+		if ( compiled )
+			return shader;
+		gl.deleteShader( shader );
+		return 0;
+	}
+
+
+	//-------------------------------------------------------
+	bool createMeshProgram()
+	{
+		GLuint vertexShader = compileShader( VERTEX_SHADER, MESH_VERTEX_SHADER );
+		GLuint fragmentShader = compileShader( FRAGMENT_SHADER, MESH_FRAGMENT_SHADER );
+		if ( vertexShader && fragmentShader )
+		{
+			meshProgram = gl.createProgram();
+			gl.attachShader( meshProgram, vertexShader );
+			gl.attachShader( meshProgram, fragmentShader );
+			gl.bindAttribLocation( meshProgram, VERTEX_ATTRIBUTE, "vertex" );
+			gl.bindAttribLocation( meshProgram, PLACEMENT_ATTRIBUTE, "placement" );
+			gl.linkProgram( meshProgram );
+
+			GLint linked = GL_FALSE;
+			gl.getProgramiv( meshProgram, LINK_STATUS, &linked );
+			if ( !linked )
+			{
+				gl.deleteProgram( meshProgram );
+				meshProgram = 0;
+			}
+		}
+
+		// The program keeps the attached shaders until it is deleted itself, deleting 0 is ignored
+		gl.deleteShader( vertexShader );
+		gl.deleteShader( fragmentShader );
+		return meshProgram != 0;
+	}
+}
+#endif
+
+
+namespace
 {
-	class Mesh
+	// Static geometry of one mesh type plus the instances published for drawing.
+	// Vertices are baked with the mesh's local rotation and scale on construction, so only
+	// the per-instance placement is left to apply. The outline loop is unrolled into separate
+	// segments, because GL_LINE_LOOP can't be merged across instances in a single draw call.
+	// With instanced drawing the baked vertices are uploaded once into a static buffer object by createGeometry
+	// and only the instance placements are written into the streaming buffer at publish. Without it
+	// the placed vertices are written there instead, in parallel over the instances, and drawn as client arrays.
+	// Instances outside the view are dropped, and when the mesh is only a few pixels large on screen,
+	// the whole batch is drawn as points instead of the fill and outline geometry.
+	class MeshBatch
 	{
 	public:
-		float positionX = 0.f;
-		float positionY = 0.f;
-		float angle = 0.f;
+		MeshBatch( std::initializer_list< Vertex > fill, Color fillColor,
+				   std::initializer_list< Vertex > outline, Color outlineColor,
+				   float localAngle, float localScale );
+
+		void reserveInstances( std::size_t count );
+		void beginInstances( View const &view );
+		void addInstance( float x, float y, float angle );
 
-		virtual ~Mesh();
-		virtual void draw();
-		virtual void update( float dt );
+		std::size_t getVertexBytes() const;
+		void allocateVertices();
+		void writeVertices() const;
 
-		static std::vector< Mesh* > meshes;
+		void createGeometry();
+		void destroyGeometry();
+		void draw();
+
+	private:
+		bool isExpanded() const { return !usePoints && !instancedDraw; }
+		void transformVertices( std::vector< Vertex > const &model, streambuffer::Range const &range, int begin, int end ) const;
+		void drawInstanced() const;
+
+		std::vector< Vertex > fillVertices;
+		std::vector< Vertex > outlineVertices;
+		Color fillColor;
+		Color outlineColor;
+
+		// Bounds the baked vertices, for culling
+		float radius = 0.f;
+
+		View view = {};
+		bool usePoints = false;
+		float pointSize = MIN_POINT_SIZE;
+
+		// The points or the instance placements are written into the fill range
+		std::vector< Instance > instances;
+		streambuffer::Range fillRange = {};
+		streambuffer::Range outlineRange = {};
+
+#ifndef WOTS_HEADLESS
+		// The fill vertices followed by the outline ones
+		GLuint geometryBuffer = 0;
+#endif
 	};
 
 
 	//-------------------------------------------------------
-	std::vector< Mesh* > Mesh::meshes;
+	MeshBatch::MeshBatch( std::initializer_list< Vertex > fill, Color fillColor,
+						  std::initializer_list< Vertex > outline, Color outlineColor,
+						  float localAngle, float localScale ) :
+		fillColor( fillColor ),
+		outlineColor( outlineColor )
+	{
+		float c = std::cos( localAngle ) * localScale;
+		float s = std::sin( localAngle ) * localScale;
+		auto bake = [ c, s ]( Vertex const &v ) { return Vertex{ c * v.x - s * v.y, s * v.x + c * v.y }; };
+
+		for ( Vertex const &v : fill )
+			fillVertices.push_back( bake( v ) );
+
+		Vertex const *loop = outline.begin();
+		for ( size_t i = 0; i < outline.size(); ++i )
+		{
+			outlineVertices.push_back( bake( loop[ i ] ) );
+			outlineVertices.push_back( bake( loop[ ( i + 1 ) % outline.size() ] ) );
+		}
+
+		for ( std::vector< Vertex > const *vertices : { &fillVertices, &outlineVertices } )
+			for ( Vertex const &v : *vertices )
+				radius = std::max( radius, std::sqrt( v.x * v.x + v.y * v.y ) );
+	}
 
 
 	//-------------------------------------------------------
-	Mesh::~Mesh()
+	void MeshBatch::reserveInstances( std::size_t count )
 	{
+		instances.reserve( count );
 	}
 
 
 	//-------------------------------------------------------
-	void Mesh::draw()
+	void MeshBatch::beginInstances( View const &newView )
 	{
-		glLoadIdentity();
-		glTranslatef( positionX, positionY, 0.f );
-		glRotatef( angle * 180.f / 3.14159265f, 0.f, 0.f, 1.f );
+		view = newView;
+		float pixelRadius = radius * view.pixelsPerUnit;
+		usePoints = pixelRadius < POINT_RADIUS;
+		pointSize = std::max( 2.f * pixelRadius, MIN_POINT_SIZE );
+		instances.clear();
 	}
 
 
 	//-------------------------------------------------------
-	void Mesh::update( float dt )
+	void MeshBatch::addInstance( float x, float y, float angle )
 	{
+		if ( !view.contains( x, y, radius ) )
+			return;
+
+		// Points are not rotated
+		Instance instance = { x, y, 1.f, 0.f };
+		if ( !usePoints )
+			fastmath::sincos( angle, &instance.sinAngle, &instance.cosAngle );
+		instances.push_back( instance );
 	}
 
 
 	//-------------------------------------------------------
-	template< class MeshClass >
-	Mesh *createMesh()
+	std::size_t MeshBatch::getVertexBytes() const
 	{
-		Mesh *mesh = new MeshClass;
-		Mesh::meshes.push_back( mesh );
-		return mesh;
+		if ( usePoints )
+			return streambuffer::getAllocationSize( instances.size() * sizeof( Vertex ) );
+		if ( instancedDraw )
+			return streambuffer::getAllocationSize( instances.size() * sizeof( Instance ) );
+		return streambuffer::getAllocationSize( instances.size() * fillVertices.size() * sizeof( Vertex ) ) +
+			   streambuffer::getAllocationSize( instances.size() * outlineVertices.size() * sizeof( Vertex ) );
 	}
 
 
 	//-------------------------------------------------------
-	void destroyMesh( Mesh *mesh )
+	void MeshBatch::allocateVertices()
 	{
-		auto it = std::find( Mesh::meshes.begin(), Mesh::meshes.end(), mesh );
-		assert( it != Mesh::meshes.end() );
-		Mesh::meshes.erase( it );
-		delete mesh;
+		if ( usePoints )
+		{
+			fillRange = streambuffer::allocate( instances.size() * sizeof( Vertex ) );
+			outlineRange = streambuffer::Range{};
+		}
+		else if ( instancedDraw )
+		{
+			fillRange = streambuffer::allocate( instances.size() * sizeof( Instance ) );
+			outlineRange = streambuffer::Range{};
+		}
+		else
+		{
+			fillRange = streambuffer::allocate( instances.size() * fillVertices.size() * sizeof( Vertex ) );
+			outlineRange = streambuffer::allocate( instances.size() * outlineVertices.size() * sizeof( Vertex ) );
+		}
+		if ( !fillRange.data || ( isExpanded() && !outlineRange.data ) )
+			instances.clear();
 	}
 
 
 	//-------------------------------------------------------
-	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	void MeshBatch::transformVertices( std::vector< Vertex > const &model, streambuffer::Range const &range, int begin, int end ) const
+	{
+		Vertex *out = static_cast< Vertex * >( range.data ) + begin * model.size();
+		for ( int i = begin; i < end; ++i )
+		{
+			Instance const &instance = instances[ i ];
+			float c = instance.cosAngle;
+			float s = instance.sinAngle;
+			for ( Vertex const &v : model )
+			{
+				out->x = instance.x + c * v.x - s * v.y;
+				out->y = instance.y + s * v.x + c * v.y;
+				++out;
+			}
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void MeshBatch::writeVertices() const
+	{
+		jobs::parallelFor( ( int )instances.size(), INSTANCES_PER_JOB, [ this ]( int begin, int end )
+		{
+			if ( usePoints )
+			{
+				Vertex *points = static_cast< Vertex * >( fillRange.data );
+				for ( int i = begin; i < end; ++i )
+					points[ i ] = Vertex{ instances[ i ].x, instances[ i ].y };
+				return;
+			}
+			if ( instancedDraw )
+			{
+				std::copy( instances.begin() + begin, instances.begin() + end, static_cast< Instance * >( fillRange.data ) + begin );
+				return;
+			}
+			transformVertices( fillVertices, fillRange, begin, end );
+			transformVertices( outlineVertices, outlineRange, begin, end );
+		} );
+	}
+
+
+#ifndef WOTS_HEADLESS
+	//-------------------------------------------------------
+	void MeshBatch::createGeometry()
+	{
+		std::vector< Vertex > geometry( fillVertices );
+		geometry.insert( geometry.end(), outlineVertices.begin(), outlineVertices.end() );
+
+		gl.genBuffers( 1, &geometryBuffer );
+		gl.bindBuffer( ARRAY_BUFFER, geometryBuffer );
+		gl.bufferData( ARRAY_BUFFER, ( BufferSize )( geometry.size() * sizeof( Vertex ) ), geometry.data(), STATIC_DRAW );
+		gl.bindBuffer( ARRAY_BUFFER, 0 );
+	}
+
+
+	//-------------------------------------------------------
+	void MeshBatch::destroyGeometry()
+	{
+		if ( !geometryBuffer )
+			return;
+
+		gl.deleteBuffers( 1, &geometryBuffer );
+		geometryBuffer = 0;
+	}
+
+
+	//-------------------------------------------------------
+	void MeshBatch::drawInstanced() const
 	{
-		mesh->positionX = x;
-		mesh->positionY = y;
-		mesh->angle = angle;
+		// The placements are read from the streaming buffer, bound since its beginDraw
+		gl.useProgram( meshProgram );
+		gl.enableVertexAttribArray( VERTEX_ATTRIBUTE );
+		gl.enableVertexAttribArray( PLACEMENT_ATTRIBUTE );
+		gl.vertexAttribDivisor( PLACEMENT_ATTRIBUTE, 1 );
+		gl.vertexAttribPointer( PLACEMENT_ATTRIBUTE, 4, GL_FLOAT, GL_FALSE, 0, streambuffer::getDrawPointer( fillRange.offset ) );
+
+		// The outline vertices follow the fill ones in the same buffer
+		gl.bindBuffer( ARRAY_BUFFER, geometryBuffer );
+		gl.vertexAttribPointer( VERTEX_ATTRIBUTE, 2, GL_FLOAT, GL_FALSE, 0, nullptr );
+
+		glColor3f( fillColor.r, fillColor.g, fillColor.b );
+		gl.drawArraysInstanced( GL_TRIANGLES, 0, ( GLsizei )fillVertices.size(), ( GLsizei )instances.size() );
+
+		glLineWidth( 2.f );
+		glColor3f( outlineColor.r, outlineColor.g, outlineColor.b );
+		gl.drawArraysInstanced( GL_LINES, ( GLint )fillVertices.size(), ( GLsizei )outlineVertices.size(), ( GLsizei )instances.size() );
+
+		// The draws after the batch take their pointers from the streaming buffer again, or from client memory
+		gl.bindBuffer( ARRAY_BUFFER, 0 );
+		streambuffer::beginDraw();
+		gl.vertexAttribDivisor( PLACEMENT_ATTRIBUTE, 0 );
+		gl.disableVertexAttribArray( PLACEMENT_ATTRIBUTE );
+		gl.disableVertexAttribArray( VERTEX_ATTRIBUTE );
+		gl.useProgram( 0 );
 	}
+
+
+	//-------------------------------------------------------
+	void MeshBatch::draw()
+	{
+		if ( instances.empty() )
+			return;
+
+		glLoadIdentity();
+		if ( !usePoints && instancedDraw )
+		{
+			drawInstanced();
+			return;
+		}
+
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, 0, streambuffer::getDrawPointer( fillRange.offset ) );
+
+		if ( usePoints )
+		{
+			glPointSize( pointSize );
+			glColor3f( outlineColor.r, outlineColor.g, outlineColor.b );
+			glDrawArrays( GL_POINTS, 0, ( GLsizei )instances.size() );
+			glDisableClientState( GL_VERTEX_ARRAY );
+			return;
+		}
+
+		glColor3f( fillColor.r, fillColor.g, fillColor.b );
+		glDrawArrays( GL_TRIANGLES, 0, ( GLsizei )( instances.size() * fillVertices.size() ) );
+
+		glVertexPointer( 2, GL_FLOAT, 0, streambuffer::getDrawPointer( outlineRange.offset ) );
+		glLineWidth( 2.f );
+		glColor3f( outlineColor.r, outlineColor.g, outlineColor.b );
+		glDrawArrays( GL_LINES, 0, ( GLsizei )( instances.size() * outlineVertices.size() ) );
+
+		glDisableClientState( GL_VERTEX_ARRAY );
+	}
+#endif
 }
 
 
 //-------------------------------------------------------
-//	user interface: ShipMesh support
+//	user interface: common mesh support
 //-------------------------------------------------------
 
 namespace
 {
-	class ShipMesh : public scene::Mesh
+	// Common part of all mesh types. There are no virtual functions: meshes of one type are
+	// stored together and each type is published by its own statically dispatched loop.
+	// The placement of the previous simulation step is kept to interpolate between them when publishing.
+	class MeshBase
 	{
 	public:
-		void draw() override;
+		float positionX = 0.f;
+		float positionY = 0.f;
+		float angle = 0.f;
+
+		float previousPositionX = 0.f;
+		float previousPositionY = 0.f;
+		float previousAngle = 0.f;
+		bool isPlaced = false;
+
+		void place( float x, float y, float newAngle );
+		void savePlacement();
+		void publishTo( MeshBatch &batch, float alpha ) const;
 	};
 
 
 	//-------------------------------------------------------
-	void ShipMesh::draw()
+	void MeshBase::place( float x, float y, float newAngle )
 	{
-		Mesh::draw();
+		positionX = x;
+		positionY = y;
+		angle = newAngle;
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
-		glScalef( 0.8f, 0.8f, 0.8f );
+		// A new mesh has no previous placement, it must not fly in from the origin
+		if ( !isPlaced )
+		{
+			savePlacement();
+			isPlaced = true;
+		}
+	}
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.1f, 0.3f, 0.6f );
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
+	//-------------------------------------------------------
+	void MeshBase::savePlacement()
+	{
+		previousPositionX = positionX;
+		previousPositionY = positionY;
+		previousAngle = angle;
+	}
 
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, -0.4f );
 
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
+	//-------------------------------------------------------
+	void MeshBase::publishTo( MeshBatch &batch, float alpha ) const
+	{
+		// Angles may wrap around between steps, interpolate along the shorter arc
+		float deltaAngle = std::remainder( angle - previousAngle, 2.f * PI );
+		batch.addInstance( previousPositionX + ( positionX - previousPositionX ) * alpha,
+						   previousPositionY + ( positionY - previousPositionY ) * alpha,
+						   previousAngle + deltaAngle * alpha );
+	}
 
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( 0.15f, -0.1f );
 
-		glEnd();
+	constexpr std::uint32_t NO_SLOT = 0xffffffffu;
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.4f, 0.8f, 1.f );
-		glVertex2f( -0.1f, -0.4f );
-		glVertex2f( 0.1f, -0.4f );
-		glVertex2f( 0.15f, -0.1f );
-		glVertex2f( 0.1f, 0.4f );
-		glVertex2f( -0.1f, 0.4f );
-		glVertex2f( -0.15f, -0.1f );
-		glEnd();
+
+	// Dense storage of all meshes of one type. Removal moves the last mesh into the freed
+	// place, so the pool reports which registry slot has to be pointed to the new index.
+	template< class MeshClass >
+	class MeshPool
+	{
+	public:
+		MeshPool();
+
+		void reserve( std::size_t count );
+		std::uint32_t add( std::uint32_t slot );
+		std::uint32_t remove( std::uint32_t index );
+
+		std::vector< MeshClass > meshes;
+
+	private:
+		std::vector< std::uint32_t > slots;
+	};
+
+
+	//-------------------------------------------------------
+	template< class MeshClass >
+	MeshPool< MeshClass >::MeshPool()
+	{
+		meshes.reserve( MeshClass::POOL_RESERVE );
+		slots.reserve( MeshClass::POOL_RESERVE );
+	}
+
+
+	//-------------------------------------------------------
+	template< class MeshClass >
+	void MeshPool< MeshClass >::reserve( std::size_t count )
+	{
+		meshes.reserve( count );
+		slots.reserve( count );
+	}
+
+
+	//-------------------------------------------------------
+	template< class MeshClass >
+	std::uint32_t MeshPool< MeshClass >::add( std::uint32_t slot )
+	{
+		meshes.emplace_back();
+		slots.push_back( slot );
+		return ( std::uint32_t )meshes.size() - 1;
+	}
+
+
+	//-------------------------------------------------------
+	template< class MeshClass >
+	std::uint32_t MeshPool< MeshClass >::remove( std::uint32_t index )
+	{
+		std::uint32_t last = ( std::uint32_t )meshes.size() - 1;
+		std::uint32_t movedSlot = NO_SLOT;
+		if ( index != last )
+		{
+			meshes[ index ] = std::move( meshes[ last ] );
+			slots[ index ] = slots[ last ];
+			movedSlot = slots[ index ];
+		}
+		meshes.pop_back();
+		slots.pop_back();
+		return movedSlot;
+	}
+
+
+	// Mesh registry slots. A handle packs the slot index into the lower bits and the slot generation
+	// into the upper ones. The generation changes every time the slot is freed, so a handle of
+	// a destroyed mesh never resolves, even after its slot has been reused.
+	constexpr std::uint32_t HANDLE_INDEX_BITS = 20;
+	constexpr std::uint32_t HANDLE_INDEX_MASK = ( 1u << HANDLE_INDEX_BITS ) - 1;
+	constexpr std::uint32_t HANDLE_GENERATION_MASK = ( 1u << ( 32 - HANDLE_INDEX_BITS ) ) - 1;
+
+	constexpr std::uint8_t NO_MESH_TYPE = 0xff;
+
+
+	struct MeshSlot
+	{
+		std::uint32_t generation;
+		std::uint8_t type;		// NO_MESH_TYPE for a free slot
+		std::uint32_t index;	// index in the pool, or the next free slot for a free slot
+	};
+
+
+	std::vector< MeshSlot > meshSlots = []{ std::vector< MeshSlot > slots; slots.reserve( 1024 ); return slots; }();
+	std::uint32_t freeSlotsHead = NO_SLOT;
+	std::uint32_t freeSlotsTail = NO_SLOT;
+
+
+	//-------------------------------------------------------
+	std::uint32_t allocateSlot()
+	{
+		if ( freeSlotsHead == NO_SLOT )
+		{
+			assert( meshSlots.size() <= HANDLE_INDEX_MASK );
+			meshSlots.push_back( MeshSlot{ 1, NO_MESH_TYPE, NO_SLOT } );
+			return ( std::uint32_t )meshSlots.size() - 1;
+		}
+
+		// Free slots are reused in FIFO order, to keep generations of recently freed slots around longer
+		std::uint32_t slot = freeSlotsHead;
+		freeSlotsHead = meshSlots[ slot ].index;
+		if ( freeSlotsHead == NO_SLOT )
+			freeSlotsTail = NO_SLOT;
+		return slot;
+	}
+
+
+	//-------------------------------------------------------
+	void freeSlot( std::uint32_t slot )
+	{
+		MeshSlot &meshSlot = meshSlots[ slot ];
+		meshSlot.generation = meshSlot.generation == HANDLE_GENERATION_MASK ? 1 : meshSlot.generation + 1;
+		meshSlot.type = NO_MESH_TYPE;
+		meshSlot.index = NO_SLOT;
+
+		if ( freeSlotsTail == NO_SLOT )
+			freeSlotsHead = slot;
+		else
+			meshSlots[ freeSlotsTail ].index = slot;
+		freeSlotsTail = slot;
+	}
+
+
+	//-------------------------------------------------------
+	scene::Mesh *toMesh( std::uint32_t slot )
+	{
+		std::uintptr_t handle = ( meshSlots[ slot ].generation << HANDLE_INDEX_BITS ) | slot;
+		return reinterpret_cast< scene::Mesh* >( handle );
+	}
+
+
+	//-------------------------------------------------------
+	std::uint32_t resolveSlot( scene::Mesh *mesh )
+	{
+		// Checked in release builds too: a stale handle would silently move or destroy the mesh now in its slot
+		std::uint32_t handle = ( std::uint32_t )reinterpret_cast< std::uintptr_t >( mesh );
+		std::uint32_t slot = handle & HANDLE_INDEX_MASK;
+		if ( slot >= meshSlots.size() || meshSlots[ slot ].generation != handle >> HANDLE_INDEX_BITS )
+		{
+			std::fprintf( stderr, "scene: %s mesh handle %08x\n", slot < meshSlots.size() ? "destroyed" : "invalid", handle );
+			std::abort();
+		}
+		return slot;
 	}
 }
 
 
-namespace scene
+//-------------------------------------------------------
+//	user interface: ShipMesh support
+//-------------------------------------------------------
+
+namespace
 {
+	class ShipMesh : public MeshBase
+	{
+	public:
+		static constexpr std::uint32_t POOL_RESERVE = 64;
+
+		void publish( float alpha );
+	};
+
+
+	MeshBatch shipBatch(
+		{
+			{ -0.1f, -0.4f }, { 0.1f, -0.4f }, { 0.1f, 0.4f },
+			{ -0.1f, 0.4f }, { 0.1f, 0.4f }, { -0.1f, -0.4f },
+			{ -0.1f, -0.4f }, { -0.1f, 0.4f }, { -0.15f, -0.1f },
+			{ 0.1f, -0.4f }, { 0.1f, 0.4f }, { 0.15f, -0.1f }
+		},
+		Color{ 0.1f, 0.3f, 0.6f },
+		{
+			{ -0.1f, -0.4f }, { 0.1f, -0.4f }, { 0.15f, -0.1f },
+			{ 0.1f, 0.4f }, { -0.1f, 0.4f }, { -0.15f, -0.1f }
+		},
+		Color{ 0.4f, 0.8f, 1.f },
+		-0.5f * PI, 0.8f );
+
+
 	//-------------------------------------------------------
-	Mesh *createShipMesh()
+	void ShipMesh::publish( float alpha )
 	{
-		return createMesh< ShipMesh >();
+		publishTo( shipBatch, alpha );
 	}
 }
 
@@ -220,64 +1117,172 @@ namespace scene
 
 namespace
 {
-	class AircraftMesh : public scene::Mesh
+	class AircraftMesh : public MeshBase
 	{
 	public:
-		void draw() override;
-		void update( float dt ) override;
+		static constexpr std::uint32_t POOL_RESERVE = 1024;
 
-	private:
-		float nextParticleTimeout = 0.f;
+		void publish( float alpha );
 	};
 
 
+	MeshBatch aircraftBatch(
+		{
+			{ -0.06f, -0.1f }, { 0.06f, -0.1f }, { 0.f, 0.1f },
+			{ -0.1f, -0.1f }, { 0.1f, -0.1f }, { 0.f, 0.0f }
+		},
+		Color{ 0.5f, 0.6f, 0.1f },
+		{
+			{ -0.1f, -0.1f }, { 0.1f, -0.1f }, { 0.04f, -0.04f },
+			{ 0.f, 0.1f }, { -0.04f, -0.04f }
+		},
+		Color{ 0.8f, 1.f, 0.2f },
+		-0.5f * PI, 1.f );
+
+
 	//-------------------------------------------------------
-	void AircraftMesh::draw()
+	void AircraftMesh::publish( float alpha )
 	{
-		Mesh::draw();
+		publishTo( aircraftBatch, alpha );
+	}
+}
 
-		glRotatef( -90.f, 0.f, 0.f, 1.f );
 
-		glBegin( GL_TRIANGLES );
-		glColor3f( 0.5f, 0.6f, 0.1f );
-		glVertex2f( -0.06f, -0.1f );
-		glVertex2f( 0.06f, -0.1f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.f, 0.0f );
-		glEnd();
+//-------------------------------------------------------
+//	user interface: mesh registry
+//-------------------------------------------------------
 
-		glLineWidth( 2.f );
-		glBegin( GL_LINE_LOOP );
-		glColor3f( 0.8f, 1.f, 0.2f );
-		glVertex2f( -0.1f, -0.1f );
-		glVertex2f( 0.1f, -0.1f );
-		glVertex2f( 0.04f, -0.04f );
-		glVertex2f( 0.f, 0.1f );
-		glVertex2f( -0.04f, -0.04f );
-		glEnd();
-	}
+namespace
+{
+	template< class MeshClass, class... MeshClasses >
+	struct MeshTypeIndex;
+
+
+	template< class MeshClass, class... Rest >
+	struct MeshTypeIndex< MeshClass, MeshClass, Rest... > : std::integral_constant< std::uint8_t, 0 >
+	{
+	};
 
 
-	void AircraftMesh::update( float dt )
+	template< class MeshClass, class Other, class... Rest >
+	struct MeshTypeIndex< MeshClass, Other, Rest... > : std::integral_constant< std::uint8_t, 1 + MeshTypeIndex< MeshClass, Rest... >::value >
 	{
-		nextParticleTimeout -= dt;
-		if ( nextParticleTimeout <= 0.f )
+	};
+
+
+	// One homogeneous pool per mesh type from the compile-time list. All loops over meshes are
+	// expanded per type, so there is no per-mesh type dispatch anywhere in update and publish.
+	template< class... MeshClasses >
+	class MeshRegistry
+	{
+	public:
+		template< class MeshClass >
+		MeshPool< MeshClass > &getPool()
+		{
+			return std::get< MeshPool< MeshClass > >( pools );
+		}
+
+		template< class MeshClass >
+		static constexpr std::uint8_t getType()
 		{
-			nextParticleTimeout += 0.1f;
-			addParticle( positionX, positionY, 0.8f, Color{ 1.f, 1.f, 1.f } );
+			return MeshTypeIndex< MeshClass, MeshClasses... >::value;
 		}
+
+		// Calls function( pool ) for each pool in the order of the type list
+		template< class Function >
+		void forEachPool( Function &&function )
+		{
+			int expand[] = { ( function( getPool< MeshClasses >() ), 0 )... };
+			( void )expand;
+		}
+
+		// Calls function( pool ) for the pool of the given runtime type
+		template< class Function >
+		void visitPool( std::uint8_t type, Function &&function )
+		{
+			int expand[] = { ( type == getType< MeshClasses >() ? ( function( getPool< MeshClasses >() ), 0 ) : 0 )... };
+			( void )expand;
+		}
+
+	private:
+		std::tuple< MeshPool< MeshClasses >... > pools;
+	};
+
+
+	MeshRegistry< ShipMesh, AircraftMesh > meshRegistry;
+
+
+	//-------------------------------------------------------
+	template< class MeshClass >
+	scene::Mesh *createMesh()
+	{
+		std::uint32_t slot = allocateSlot();
+		meshSlots[ slot ].type = meshRegistry.getType< MeshClass >();
+		meshSlots[ slot ].index = meshRegistry.getPool< MeshClass >().add( slot );
+		return toMesh( slot );
 	}
 }
 
+
 namespace scene
 {
+	// scene::Mesh is never defined: the pointers handed out to the game are registry handles
+	// in disguise, so the existing Mesh* based interface keeps working
+
+
+	//-------------------------------------------------------
+	Mesh *createShipMesh()
+	{
+		return createMesh< ShipMesh >();
+	}
+
+
 	//-------------------------------------------------------
 	Mesh *createAircraftMesh()
 	{
 		return createMesh< AircraftMesh >();
 	}
+
+
+	//-------------------------------------------------------
+	void destroyMesh( Mesh *mesh )
+	{
+		std::uint32_t slot = resolveSlot( mesh );
+		MeshSlot const &meshSlot = meshSlots[ slot ];
+		meshRegistry.visitPool( meshSlot.type, [ &meshSlot ]( auto &pool )
+		{
+			std::uint32_t movedSlot = pool.remove( meshSlot.index );
+			if ( movedSlot != NO_SLOT )
+				meshSlots[ movedSlot ].index = meshSlot.index;
+		} );
+		freeSlot( slot );
+	}
+
+
+	//-------------------------------------------------------
+	void reserveMeshes( int shipCount, int aircraftCount )
+	{
+		meshSlots.reserve( shipCount + aircraftCount );
+		meshRegistry.getPool< ShipMesh >().reserve( shipCount );
+		meshRegistry.getPool< AircraftMesh >().reserve( aircraftCount );
+		shipBatch.reserveInstances( shipCount );
+		aircraftBatch.reserveInstances( aircraftCount );
+
+		trailParticles.reserve( aircraftCount * TRAILS_PER_AIRCRAFT );
+		trailStaging.x.resize( trailParticles.getCapacity() );
+		trailStaging.y.resize( trailParticles.getCapacity() );
+	}
+
+
+	//-------------------------------------------------------
+	void placeMesh( Mesh *mesh, float x, float y, float angle )
+	{
+		MeshSlot const &meshSlot = meshSlots[ resolveSlot( mesh ) ];
+		meshRegistry.visitPool( meshSlot.type, [ &meshSlot, x, y, angle ]( auto &pool )
+		{
+			pool.meshes[ meshSlot.index ].place( x, y, angle );
+		} );
+	}
 }
 
 
@@ -287,34 +1292,102 @@ namespace scene
 
 namespace
 {
-	struct
+	struct GoalMarker
 	{
 		float x;
 		float y;
-	} goalMarker;
+	};
+
 
+	constexpr int GOAL_MARKER_VERTEX_COUNT = 4;
 
-	void drawGoalMarker()
+	std::vector< GoalMarker > goalMarkers( 1, GoalMarker{ 0.f, 0.f } );
+	streambuffer::Range publishedGoalMarkers = {};
+	int publishedGoalMarkerCount = 0;
+
+
+	//-------------------------------------------------------
+	std::size_t getGoalMarkerBytes()
+	{
+		return streambuffer::getAllocationSize( goalMarkers.size() * GOAL_MARKER_VERTEX_COUNT * sizeof( Vertex ) );
+	}
+
+
+	//-------------------------------------------------------
+	// All the crosses are lines of one vertex array, drawn by a single call
+	void publishGoalMarkers()
 	{
+		publishedGoalMarkerCount = 0;
+		publishedGoalMarkers = streambuffer::allocate( goalMarkers.size() * GOAL_MARKER_VERTEX_COUNT * sizeof( Vertex ) );
+		if ( !publishedGoalMarkers.data )
+			return;
+
+		Vertex *vertices = static_cast< Vertex * >( publishedGoalMarkers.data );
+		for ( GoalMarker const &marker : goalMarkers )
+		{
+			*vertices++ = Vertex{ marker.x - 0.1f, marker.y - 0.1f };
+			*vertices++ = Vertex{ marker.x + 0.1f, marker.y + 0.1f };
+			*vertices++ = Vertex{ marker.x - 0.1f, marker.y + 0.1f };
+			*vertices++ = Vertex{ marker.x + 0.1f, marker.y - 0.1f };
+		}
+		publishedGoalMarkerCount = ( int )goalMarkers.size();
+	}
+
+
+#ifndef WOTS_HEADLESS
+	void drawGoalMarkers()
+	{
+		if ( !publishedGoalMarkers.data )
+			return;
+
 		glLoadIdentity();
 		glLineWidth( 3.f );
-		glBegin( GL_LINES );
 		glColor3f( 1.0f, 0.3f, 0.2f );
-		glVertex2f( goalMarker.x - 0.1f, goalMarker.y - 0.1f );
-		glVertex2f( goalMarker.x + 0.1f, goalMarker.y + 0.1f );
-		glVertex2f( goalMarker.x - 0.1f, goalMarker.y + 0.1f );
-		glVertex2f( goalMarker.x + 0.1f, goalMarker.y - 0.1f );
-		glEnd();
+		glEnableClientState( GL_VERTEX_ARRAY );
+		glVertexPointer( 2, GL_FLOAT, 0, streambuffer::getDrawPointer( publishedGoalMarkers.offset ) );
+		glDrawArrays( GL_LINES, 0, publishedGoalMarkerCount * GOAL_MARKER_VERTEX_COUNT );
+		glDisableClientState( GL_VERTEX_ARRAY );
 	}
+#endif
 }
 
 
 namespace scene
 {
-	void placeGoalMarker( float x, float y )
+	void setGoalMarkerCount( int count )
+	{
+		assert( count > 0 );
+		goalMarkers.resize( count, GoalMarker{ 0.f, 0.f } );
+	}
+
+
+	//-------------------------------------------------------
+	void placeGoalMarker( int index, float x, float y )
+	{
+		assert( index >= 0 && index < ( int )goalMarkers.size() );
+		goalMarkers[ index ] = GoalMarker{ x, y };
+	}
+}
+
+
+//-------------------------------------------------------
+//	user interface: trail particles
+//-------------------------------------------------------
+
+namespace scene
+{
+	void emitTrails( float const *x, float const *y, int count )
 	{
-		goalMarker.x = x;
-		goalMarker.y = y;
+		static telemetry::Counter const droppedTrails( "scene.dropped_trails" );
+		int room = ( int )trailStaging.x.size() - trailStaging.size;
+		if ( count > room )
+		{
+			droppedTrails.add( count - room );
+			count = room;
+		}
+		std::copy_n( x, count, trailStaging.x.data() + trailStaging.size );
+		std::copy_n( y, count, trailStaging.y.data() + trailStaging.size );
+		trailStaging.size += count;
 	}
 }
 
@@ -326,10 +1399,32 @@ namespace scene
 namespace scene
 {
 	void screenToWorld( float *x, float *y )
+	{
+		*x = camera.x + 0.5f * VIEW_WIDTH * ( 2.f * *x - 1.f ) / camera.zoom;
+		*y = camera.y + 0.5f * VIEW_HEIGHT * ( 2.f * *y - 1.f ) / camera.zoom;
+	}
+
+
+	void unitToWorld( float *x, float *y )
 	{
 		*x = 0.5f * VIEW_WIDTH * ( 2.f * *x - 1.f );
 		*y = 0.5f * VIEW_HEIGHT * ( 2.f * *y - 1.f );
 	}
+
+
+	void setCamera( float x, float y, float zoom )
+	{
+		assert( zoom > 0.f );
+		camera = Camera{ x, y, zoom };
+	}
+
+
+	void getCamera( float *x, float *y, float *zoom )
+	{
+		*x = camera.x;
+		*y = camera.y;
+		*zoom = camera.zoom;
+	}
 }
 
 
@@ -343,44 +1438,166 @@ namespace scene
 	{
 		constexpr float TIME_BETWEEN_SEA_PARTICLES = 0.02f;
 		float timeToNextSeaParticle = 0.f;
-		std::default_random_engine seaParticlesRandomEngine( 42 );
-		std::uniform_real_distribution< float > seaParticlesHorizDistr( -0.5f * VIEW_WIDTH, 0.5f * VIEW_WIDTH );
-		std::uniform_real_distribution< float > seaParticlesVertDistr( -0.5f * VIEW_HEIGHT, 0.5f * VIEW_HEIGHT );
+		prng::Generator seaParticlesRandom( 42 );
+
+		// The gauge peak of the particles is the high-water mark of the pools
+		telemetry::Gauge const meshGauge( "scene.meshes" );
+		telemetry::Gauge const particleGauge( "scene.particles" );
 	}
 
 
-	void update( float dt )
+	void beginUpdate()
 	{
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->update( dt );
-		updateParticles( dt );
+		meshRegistry.forEachPool( []( auto &pool )
+		{
+			for ( auto &mesh : pool.meshes )
+				mesh.savePlacement();
+		} );
+	}
+
+
+	void updateParticles( float dt )
+	{
+		PROFILE_SCOPE( "scene::updateParticles" );
+		seaParticles.update( dt );
+		trailParticles.update( dt );
+	}
+
 
-		timeToNextSeaParticle += dt;
+	int getParticleCount()
+	{
+		return seaParticles.getSize() + trailParticles.getSize();
+	}
+
+
+	//-------------------------------------------------------
+	void update( float dt )
+	{
+		PROFILE_SCOPE( "scene::update" );
+		std::size_t meshCount = 0;
+		meshRegistry.forEachPool( [ &meshCount ]( auto &pool )
+		{
+			meshCount += pool.meshes.size();
+		} );
+		mergeTrails();
+
+		// A long frame would spawn more particles than the pool can hold,
+		// the extra ones would only overwrite each other
+		timeToNextSeaParticle = std::min( timeToNextSeaParticle + dt, seaParticles.getCapacity() * TIME_BETWEEN_SEA_PARTICLES );
+		int seaParticleCount = 0;
 		while ( timeToNextSeaParticle > 0.f )
 		{
 			timeToNextSeaParticle -= TIME_BETWEEN_SEA_PARTICLES;
-			addParticle( seaParticlesHorizDistr( seaParticlesRandomEngine ),
-						 seaParticlesVertDistr( seaParticlesRandomEngine ),
-						 3.f,
-						 Color{ 0.15f, 0.3f, 0.6f } );
+			++seaParticleCount;
 		}
+		seaParticles.spawn( seaParticleCount, Color{ 0.15f, 0.3f, 0.6f }, []( float *x, float *y, int count )
+		{
+			seaParticlesRandom.fill( x, count, -0.5f * VIEW_WIDTH, 0.5f * VIEW_WIDTH );
+			seaParticlesRandom.fill( y, count, -0.5f * VIEW_HEIGHT, 0.5f * VIEW_HEIGHT );
+		} );
+
+		meshGauge.set( meshCount );
+		particleGauge.set( getParticleCount() );
+	}
+
+
+	//-------------------------------------------------------
+	void getSpawnState( std::uint32_t *seaRandom, float *spawnTime )
+	{
+		seaParticlesRandom.getState( seaRandom );
+		*spawnTime = timeToNextSeaParticle;
+	}
+
+
+	void setSpawnState( std::uint32_t const *seaRandom, float spawnTime )
+	{
+		seaParticlesRandom.setState( seaRandom );
+		timeToNextSeaParticle = std::min( spawnTime, seaParticles.getCapacity() * TIME_BETWEEN_SEA_PARTICLES );
+	}
+
+
+	void publish( float alpha )
+	{
+		PROFILE_SCOPE( "scene::publish" );
+		publishedCamera = camera;
+		View view = getView( camera );
+		shipBatch.beginInstances( view );
+		aircraftBatch.beginInstances( view );
+		meshRegistry.forEachPool( [ alpha ]( auto &pool )
+		{
+			for ( auto &mesh : pool.meshes )
+				mesh.publish( alpha );
+		} );
+
+		// All dynamic geometry of the frame goes into one streaming buffer region:
+		// ranges are allocated here, then filled in parallel, particles next to the mesh batches
+		streambuffer::beginFrame( getParticleBytes() + shipBatch.getVertexBytes() + aircraftBatch.getVertexBytes() + getGoalMarkerBytes() );
+		allocateParticles();
+		shipBatch.allocateVertices();
+		aircraftBatch.allocateVertices();
+		publishGoalMarkers();
+
+		jobs::Counter particlesCounter;
+		auto particlesWriter = [ &view ]{ writeParticles( view ); };
+		jobs::run( particlesCounter, particlesWriter );
+		shipBatch.writeVertices();
+		aircraftBatch.writeVertices();
+		jobs::wait( particlesCounter );
 	}
 
 
+#ifndef WOTS_HEADLESS
 	void draw()
 	{
+		PROFILE_SCOPE( "scene::draw" );
 		glMatrixMode( GL_PROJECTION );
 		glLoadIdentity();
-		glScalef( 2.f / VIEW_WIDTH, 2.f / VIEW_HEIGHT, 0.f );
+		glScalef( 2.f * publishedCamera.zoom / VIEW_WIDTH, 2.f * publishedCamera.zoom / VIEW_HEIGHT, 0.f );
+		glTranslatef( -publishedCamera.x, -publishedCamera.y, 0.f );
 
 		glDisable( GL_CULL_FACE );
 		glClearColor( 0.1f, 0.2f, 0.4f, 0.f );
 		glClear( GL_COLOR_BUFFER_BIT );
 		glMatrixMode( GL_MODELVIEW );
 
+		streambuffer::beginDraw();
 		drawParticles();
-		for ( Mesh *mesh : Mesh::meshes )
-			mesh->draw();
-		drawGoalMarker();
+		shipBatch.draw();
+		aircraftBatch.draw();
+		drawGoalMarkers();
+		streambuffer::endDraw();
+	}
+
+
+	void initDraw()
+	{
+		deinitDraw();
+		instancedDraw = loadInstancingFunctions() && createMeshProgram();
+		if ( !instancedDraw )
+			return;
+
+		shipBatch.createGeometry();
+		aircraftBatch.createGeometry();
+	}
+
+
+	void deinitDraw()
+	{
+		if ( instancedDraw )
+		{
+			shipBatch.destroyGeometry();
+			aircraftBatch.destroyGeometry();
+			gl.deleteProgram( meshProgram );
+			meshProgram = 0;
+		}
+		instancedDraw = false;
+	}
+#endif
+
+
+	void setViewportSize( int width, int height )
+	{
+		viewportWidth = width;
+		viewportHeight = height;
 	}
 }
@@ -1,3 +1,4 @@
+#include <cstdint>
 
 
 //-------------------------------------------------------
@@ -6,6 +7,7 @@
 
 namespace scene
 {
+	// Opaque mesh handle, never dereference it. Using the handle of a destroyed mesh aborts, in release builds too
 	class Mesh;
 
 	Mesh *createShipMesh();
@@ -13,9 +15,32 @@ namespace scene
 	void destroyMesh( Mesh *mesh );
 	void placeMesh( Mesh *mesh, float x, float y, float angle );
 
+	// Makes room for that many meshes of each type, so creating and publishing them up to there doesn't allocate.
+	// The trail particles get room for all aircrafts too, when each emits one trail per 0.1 s at most
+	void reserveMeshes( int shipCount, int aircraftCount );
+
+	// Screen coordinates are [0, 1] over the window, bottom left is ( 0, 0 ) and maps through the camera
 	void screenToWorld( float *x, float *y );
 
-	void placeGoalMarker( float x, float y );
+	// The world is a fixed rectangle centered on the origin, unit coordinates are [0, 1] over it
+	void unitToWorld( float *x, float *y );
+
+	// The camera looks at ( x, y ), zoom 1 shows the whole world, larger values zoom in
+	void setCamera( float x, float y, float zoom );
+	void getCamera( float *x, float *y, float *zoom );
+
+	// Markers are indexed [0, count), new ones start at the origin, there is one marker by default
+	void setGoalMarkerCount( int count );
+	void placeGoalMarker( int index, float x, float y );
+
+	// Trail particles at the given positions. They are staged and join the particles in the next update,
+	// so the game may emit them while the particles are updated. One thread at a time, in blocks
+	void emitTrails( float const *x, float const *y, int count );
+
+	// Sea particle spawning state: 4 random lane states and the time to the next particle. A game snapshot saves it along,
+	// so a restored game spawns the same sea particles as the saved one would have
+	void getSpawnState( std::uint32_t *seaRandom, float *spawnTime );
+	void setSpawnState( std::uint32_t const *seaRandom, float spawnTime );
 }
 
 
@@ -23,8 +48,33 @@ namespace scene
 //	engine only interface
 //-------------------------------------------------------
 
+// A simulation step is beginUpdate, then updateParticles in parallel with game::update, then update.
+// publish copies the scene state for drawing, after that draw only reads the published copy:
+// the next frame can be updated while the previous one is drawn. Mesh placements are published
+// interpolated by alpha between the two last simulation steps. Trails emitted during game::update
+// join the particles in update.
+// Publishing culls meshes and particles against the camera view and switches meshes, which are only
+// a few pixels large on screen, to single points.
+// initDraw picks instanced mesh drawing from static buffer objects, when the driver supports it. Without it
+// the mesh vertices are placed on the CPU and drawn as client arrays.
+// draw, initDraw and deinitDraw are not available in the headless build ( WOTS_HEADLESS ), the rest of the scene
+// works as usual.
+
 namespace scene
 {
+	void beginUpdate();
+	void updateParticles( float dt );
 	void update( float dt );
+	void publish( float alpha );
 	void draw();
+
+	// Need the current OpenGL context and streambuffer::init, before the first publish
+	void initDraw();
+	void deinitDraw();
+
+	// Window size in pixels, for the level of detail selection
+	void setViewportSize( int width, int height );
+
+	// Alive particles after the last updateParticles, for statistics and benchmarks
+	int getParticleCount();
 }
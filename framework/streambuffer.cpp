@@ -0,0 +1,285 @@
+#ifndef WOTS_HEADLESS
+#include <windows.h>
+#include <GL/gl.h>
+#endif
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "glext.hpp"
+#include "streambuffer.hpp"
+
+
+//-------------------------------------------------------
+//	regions
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr std::size_t MIN_REGION_SIZE = 256 * 1024;
+
+	// Region r starts at base + r * regionSize
+	char *base = nullptr;
+	std::size_t regionSize = 0;
+	int region = 0;
+
+	// Allocations of the current frame, from the start of its region
+	std::size_t cursor = 0;
+	std::size_t frameSize = 0;
+
+	bool persistent = false;
+	std::vector< char > clientMemory;
+}
+
+
+#ifndef WOTS_HEADLESS
+//-------------------------------------------------------
+//	persistent mapped buffer object
+//-------------------------------------------------------
+
+namespace
+{
+	// The system headers stop at OpenGL 1.1, the rest is declared here and loaded through glext
+	typedef std::ptrdiff_t BufferSize;
+	typedef std::ptrdiff_t BufferOffset;
+	typedef struct OpaqueSync *Sync;
+
+	constexpr GLenum ARRAY_BUFFER = 0x8892;
+	constexpr GLbitfield MAP_WRITE_BIT = 0x0002;
+	constexpr GLbitfield MAP_PERSISTENT_BIT = 0x0040;
+	constexpr GLbitfield MAP_COHERENT_BIT = 0x0080;
+	constexpr GLenum SYNC_GPU_COMMANDS_COMPLETE = 0x9117;
+	constexpr GLbitfield SYNC_FLUSH_COMMANDS_BIT = 0x0001;
+	constexpr GLenum TIMEOUT_EXPIRED = 0x911B;
+	constexpr std::uint64_t WAIT_TIMEOUT_NS = 1000000;
+
+
+	struct BufferFunctions
+	{
+		void ( APIENTRY *genBuffers )( GLsizei count, GLuint *buffers );
+		void ( APIENTRY *deleteBuffers )( GLsizei count, GLuint const *buffers );
+		void ( APIENTRY *bindBuffer )( GLenum target, GLuint buffer );
+		void ( APIENTRY *bufferStorage )( GLenum target, BufferSize size, void const *data, GLbitfield flags );
+		void *( APIENTRY *mapBufferRange )( GLenum target, BufferOffset offset, BufferSize length, GLbitfield access );
+		GLboolean ( APIENTRY *unmapBuffer )( GLenum target );
+		Sync ( APIENTRY *fenceSync )( GLenum condition, GLbitfield flags );
+		GLenum ( APIENTRY *clientWaitSync )( Sync sync, GLbitfield flags, std::uint64_t timeout );
+		void ( APIENTRY *deleteSync )( Sync sync );
+	};
+
+
+	BufferFunctions gl = {};
+	GLuint bufferObject = 0;
+	Sync fences[ streambuffer::FRAME_COUNT ] = {};
+
+
+	//-------------------------------------------------------
+	bool loadBufferFunctions()
+	{
+		if ( !glext::hasExtension( "GL_ARB_buffer_storage" ) || !glext::hasExtension( "GL_ARB_sync" ) )
+			return false;
+
+		return glext::load( &gl.genBuffers, "glGenBuffers" ) &&
+			   glext::load( &gl.deleteBuffers, "glDeleteBuffers" ) &&
+			   glext::load( &gl.bindBuffer, "glBindBuffer" ) &&
+			   glext::load( &gl.bufferStorage, "glBufferStorage" ) &&
+			   glext::load( &gl.mapBufferRange, "glMapBufferRange" ) &&
+			   glext::load( &gl.unmapBuffer, "glUnmapBuffer" ) &&
+			   glext::load( &gl.fenceSync, "glFenceSync" ) &&
+			   glext::load( &gl.clientWaitSync, "glClientWaitSync" ) &&
+			   glext::load( &gl.deleteSync, "glDeleteSync" );
+	}
+
+
+	//-------------------------------------------------------
+	void waitFence( int index )
+	{
+		if ( !fences[ index ] )
+			return;
+
+		// The region was drawn FRAME_COUNT frames ago, normally its fence is signaled long before
+		while ( gl.clientWaitSync( fences[ index ], SYNC_FLUSH_COMMANDS_BIT, WAIT_TIMEOUT_NS ) == TIMEOUT_EXPIRED )
+			;
+		gl.deleteSync( fences[ index ] );
+		fences[ index ] = nullptr;
+	}
+
+
+	//-------------------------------------------------------
+	bool createBuffer( std::size_t size )
+	{
+		GLbitfield flags = MAP_WRITE_BIT | MAP_PERSISTENT_BIT | MAP_COHERENT_BIT;
+		gl.genBuffers( 1, &bufferObject );
+		gl.bindBuffer( ARRAY_BUFFER, bufferObject );
+		gl.bufferStorage( ARRAY_BUFFER, ( BufferSize )size, nullptr, flags );
+		base = ( char * )gl.mapBufferRange( ARRAY_BUFFER, 0, ( BufferSize )size, flags );
+		gl.bindBuffer( ARRAY_BUFFER, 0 );
+		return base != nullptr;
+	}
+
+
+	//-------------------------------------------------------
+	void destroyBuffer()
+	{
+		if ( !bufferObject )
+			return;
+
+		for ( int i = 0; i < streambuffer::FRAME_COUNT; ++i )
+			waitFence( i );
+
+		if ( base )
+		{
+			gl.bindBuffer( ARRAY_BUFFER, bufferObject );
+			gl.unmapBuffer( ARRAY_BUFFER );
+			gl.bindBuffer( ARRAY_BUFFER, 0 );
+		}
+		gl.deleteBuffers( 1, &bufferObject );
+		bufferObject = 0;
+		base = nullptr;
+	}
+}
+#endif
+
+
+//-------------------------------------------------------
+//	allocation
+//-------------------------------------------------------
+
+namespace
+{
+	//-------------------------------------------------------
+	void reserve( std::size_t size )
+	{
+		if ( size <= regionSize )
+			return;
+
+		std::size_t newSize = std::max( MIN_REGION_SIZE, 2 * regionSize );
+		while ( newSize < size )
+			newSize *= 2;
+
+#ifndef WOTS_HEADLESS
+		// Growing is a full stall, it only happens the first few times the scene gets bigger
+		if ( persistent )
+		{
+			destroyBuffer();
+			if ( createBuffer( newSize * streambuffer::FRAME_COUNT ) )
+			{
+				regionSize = newSize;
+				return;
+			}
+			destroyBuffer();
+			persistent = false;
+		}
+#endif
+
+		// Client arrays are consumed by the draw calls, the old contents can go right away
+		clientMemory.resize( newSize * streambuffer::FRAME_COUNT );
+		base = clientMemory.data();
+		regionSize = newSize;
+	}
+}
+
+
+//-------------------------------------------------------
+//	public streaming buffer interface
+//-------------------------------------------------------
+
+namespace streambuffer
+{
+	//-------------------------------------------------------
+	void init()
+	{
+		deinit();
+#ifndef WOTS_HEADLESS
+		persistent = loadBufferFunctions();
+#endif
+	}
+
+
+	//-------------------------------------------------------
+	void deinit()
+	{
+#ifndef WOTS_HEADLESS
+		if ( persistent )
+			destroyBuffer();
+#endif
+		persistent = false;
+		clientMemory = std::vector< char >();
+		base = nullptr;
+		regionSize = 0;
+		cursor = 0;
+		frameSize = 0;
+	}
+
+
+	//-------------------------------------------------------
+	bool isPersistent()
+	{
+		return persistent;
+	}
+
+
+	//-------------------------------------------------------
+	void beginFrame( std::size_t size )
+	{
+		region = ( region + 1 ) % FRAME_COUNT;
+#ifndef WOTS_HEADLESS
+		if ( persistent )
+			waitFence( region );
+#endif
+		reserve( size );
+		cursor = 0;
+		frameSize = size;
+	}
+
+
+	//-------------------------------------------------------
+	Range allocate( std::size_t size )
+	{
+		std::size_t allocationSize = getAllocationSize( size );
+		assert( cursor + allocationSize <= frameSize && "allocation is not counted in beginFrame" );
+		if ( cursor + allocationSize > regionSize )
+			return Range{ nullptr, 0 };
+
+		std::size_t offset = region * regionSize + cursor;
+		cursor += allocationSize;
+		return Range{ base + offset, offset };
+	}
+
+
+	//-------------------------------------------------------
+	void beginDraw()
+	{
+#ifndef WOTS_HEADLESS
+		if ( persistent )
+			gl.bindBuffer( ARRAY_BUFFER, bufferObject );
+#endif
+	}
+
+
+	//-------------------------------------------------------
+	void const *getDrawPointer( std::size_t offset )
+	{
+		// With a bound buffer object gl*Pointer takes offsets into it
+		if ( persistent )
+			return reinterpret_cast< void const * >( offset );
+		return base + offset;
+	}
+
+
+	//-------------------------------------------------------
+	void endDraw()
+	{
+#ifndef WOTS_HEADLESS
+		if ( persistent )
+		{
+			gl.bindBuffer( ARRAY_BUFFER, 0 );
+			if ( fences[ region ] )
+				gl.deleteSync( fences[ region ] );
+			fences[ region ] = gl.fenceSync( SYNC_GPU_COMMANDS_COMPLETE, 0 );
+		}
+#endif
+	}
+}
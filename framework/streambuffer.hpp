@@ -0,0 +1,54 @@
+//-------------------------------------------------------
+//	streaming buffer for per-frame geometry
+//-------------------------------------------------------
+
+/*
+ * All geometry, which changes every frame, is written straight into one buffer split into FRAME_COUNT regions
+ * A frame allocates its ranges from the next region, the region is reused only after the GPU is done
+ * with the frame drawn from it FRAME_COUNT frames ago, so the writers never wait in the common case
+ *
+ * With GL_ARB_buffer_storage the buffer is a persistently and coherently mapped vertex buffer object,
+ * the regions are guarded by fences. Without it, in the headless build and before init,
+ * the regions are plain client memory and are drawn as client vertex arrays
+ *
+ * beginFrame and allocate are called from the main thread, the returned ranges may be filled from any thread
+ * until the first draw call, which reads them
+ */
+
+#include <cstddef>
+
+
+namespace streambuffer
+{
+	constexpr int FRAME_COUNT = 3;
+
+
+	struct Range
+	{
+		void *data;
+		std::size_t offset;		// from the start of the buffer, for getDrawPointer
+	};
+
+
+	// Needs the current OpenGL context, picks the persistent mapped buffer when the driver supports it
+	void init();
+	void deinit();
+	bool isPersistent();
+
+	// Moves to the next region and makes it hold at least size bytes of allocations
+	// Waits for the GPU when the region is still in use, reallocates the buffer when it is too small
+	void beginFrame( std::size_t size );
+
+	// Ranges are aligned to ALIGNMENT, their sizes are rounded up to it: count them like that in beginFrame
+	constexpr std::size_t ALIGNMENT = 16;
+	constexpr std::size_t getAllocationSize( std::size_t size ) { return ( size + ALIGNMENT - 1 ) & ~( ALIGNMENT - 1 ); }
+	Range allocate( std::size_t size );
+
+	// Draw side, from the thread owning the context: binds the buffer of the current frame,
+	// after that getDrawPointer( range.offset ) is the pointer argument for gl*Pointer calls
+	void beginDraw();
+	void const *getDrawPointer( std::size_t offset );
+
+	// Unbinds the buffer and fences the current region after its last draw call
+	void endDraw();
+}
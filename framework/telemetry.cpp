@@ -0,0 +1,393 @@
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <thread>
+
+#include "memory.hpp"
+#include "profiler.hpp"
+#include "telemetry.hpp"
+
+
+//-------------------------------------------------------
+//	metric registry
+//-------------------------------------------------------
+
+namespace
+{
+	// Metrics with the same name share their values, a stray metric beyond the capacity goes to the last one
+	template< int Capacity >
+	struct Registry
+	{
+		char const *names[ Capacity ] = {};
+		std::atomic< int > count{ 0 };
+	};
+
+
+	Registry< telemetry::MAX_COUNTERS > counters;
+	Registry< telemetry::MAX_GAUGES > gauges;
+	Registry< telemetry::MAX_HISTOGRAMS > histograms;
+	std::mutex registryMutex;
+
+
+	//-------------------------------------------------------
+	template< int Capacity >
+	int registerMetric( Registry< Capacity > &registry, char const *name )
+	{
+		std::lock_guard< std::mutex > lock( registryMutex );
+		int count = registry.count.load( std::memory_order_relaxed );
+		for ( int i = 0; i < count; ++i )
+			if ( std::strcmp( registry.names[ i ], name ) == 0 )
+				return i;
+
+		assert( count < Capacity && "too many telemetry metrics" );
+		if ( count == Capacity )
+			return Capacity - 1;
+
+		registry.names[ count ] = name;
+		registry.count.store( count + 1, std::memory_order_release );
+		return count;
+	}
+}
+
+
+//-------------------------------------------------------
+//	metric values
+//-------------------------------------------------------
+
+namespace
+{
+	constexpr int SHARD_COUNT = 8;
+	constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+	// Values below SUB_BUCKET_COUNT get a bucket each, every octave above is split into SUB_BUCKET_COUNT buckets
+	constexpr int SUB_BUCKET_COUNT = 4;
+	constexpr int BUCKET_COUNT = SUB_BUCKET_COUNT * 62;
+
+
+	struct HistogramShard
+	{
+		std::atomic< std::uint32_t > buckets[ BUCKET_COUNT ];
+		std::atomic< std::int64_t > sum;
+		std::atomic< std::int64_t > max;
+	};
+
+
+	// Static storage starts zeroed, the atomics need no constructor
+	struct alignas( CACHE_LINE_SIZE ) Shard
+	{
+		std::atomic< std::int64_t > counters[ telemetry::MAX_COUNTERS ];
+		HistogramShard histograms[ telemetry::MAX_HISTOGRAMS ];
+	};
+
+
+	struct GaugeValue
+	{
+		std::atomic< std::int64_t > value{ 0 };
+		std::atomic< std::int64_t > peak{ 0 };
+	};
+
+
+	Shard shards[ SHARD_COUNT ];
+	std::atomic< int > nextShard{ 0 };
+	GaugeValue gaugeValues[ telemetry::MAX_GAUGES ];
+
+
+	//-------------------------------------------------------
+	Shard &getShard()
+	{
+		// Threads take the shards in turn, a shard is shared only by more threads than there are shards
+		thread_local Shard &shard = shards[ nextShard.fetch_add( 1, std::memory_order_relaxed ) % SHARD_COUNT ];
+		return shard;
+	}
+
+
+	//-------------------------------------------------------
+	void raise( std::atomic< std::int64_t > &target, std::int64_t value )
+	{
+		std::int64_t current = target.load( std::memory_order_relaxed );
+		while ( value > current && !target.compare_exchange_weak( current, value, std::memory_order_relaxed ) )
+		{
+		}
+	}
+
+
+	//-------------------------------------------------------
+	int getBucket( std::int64_t value )
+	{
+		if ( value < SUB_BUCKET_COUNT )
+			return value > 0 ? ( int )value : 0;
+
+		// Binary search for the highest set bit, 2 at least here
+		int exponent = 0;
+		for ( int shift = 32; shift > 0; shift >>= 1 )
+			if ( value >> ( exponent + shift ) )
+				exponent += shift;
+		return SUB_BUCKET_COUNT * ( exponent - 1 ) + ( int )( ( value >> ( exponent - 2 ) ) & ( SUB_BUCKET_COUNT - 1 ) );
+	}
+
+
+	//-------------------------------------------------------
+	std::int64_t getBucketValue( int bucket )
+	{
+		if ( bucket < SUB_BUCKET_COUNT )
+			return bucket;
+
+		int exponent = bucket / SUB_BUCKET_COUNT + 1;
+		return ( std::int64_t )( SUB_BUCKET_COUNT + bucket % SUB_BUCKET_COUNT ) << ( exponent - 2 );
+	}
+}
+
+
+//-------------------------------------------------------
+//	writer thread
+//-------------------------------------------------------
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+
+	std::thread writer;
+	std::mutex writerMutex;
+	std::condition_variable writerWakeUp;
+	bool stopping = false;
+	bool writerOpened = false;
+
+	char const *writerPath = nullptr;
+	Clock::duration writerInterval;
+	std::int64_t previousTotals[ telemetry::MAX_COUNTERS ] = {};
+
+
+	//-------------------------------------------------------
+	void writeCounters( FILE *file, long long time, double elapsed )
+	{
+		int count = counters.count.load( std::memory_order_acquire );
+		for ( int i = 0; i < count; ++i )
+		{
+			std::int64_t total = 0;
+			for ( Shard const &shard : shards )
+				total += shard.counters[ i ].load( std::memory_order_relaxed );
+
+			double rate = elapsed > 0.0 ? ( total - previousTotals[ i ] ) / elapsed : 0.0;
+			previousTotals[ i ] = total;
+			std::fprintf( file, "%s %lld %lld\n", counters.names[ i ], ( long long )total, time );
+			std::fprintf( file, "%s.rate %.3f %lld\n", counters.names[ i ], rate, time );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void writeGauges( FILE *file, long long time )
+	{
+		int count = gauges.count.load( std::memory_order_acquire );
+		for ( int i = 0; i < count; ++i )
+		{
+			GaugeValue const &gauge = gaugeValues[ i ];
+			std::fprintf( file, "%s %lld %lld\n", gauges.names[ i ], ( long long )gauge.value.load( std::memory_order_relaxed ), time );
+			std::fprintf( file, "%s.peak %lld %lld\n", gauges.names[ i ], ( long long )gauge.peak.load( std::memory_order_relaxed ), time );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void writeHistograms( FILE *file, long long time )
+	{
+		int count = histograms.count.load( std::memory_order_acquire );
+		for ( int i = 0; i < count; ++i )
+		{
+			// Taking the values resets them, every record counts in exactly one interval
+			std::uint64_t buckets[ BUCKET_COUNT ] = {};
+			std::uint64_t recordCount = 0;
+			std::int64_t sum = 0;
+			std::int64_t max = 0;
+			for ( Shard &shard : shards )
+			{
+				HistogramShard &histogram = shard.histograms[ i ];
+				for ( int bucket = 0; bucket < BUCKET_COUNT; ++bucket )
+				{
+					std::uint32_t bucketCount = histogram.buckets[ bucket ].exchange( 0, std::memory_order_relaxed );
+					buckets[ bucket ] += bucketCount;
+					recordCount += bucketCount;
+				}
+				sum += histogram.sum.exchange( 0, std::memory_order_relaxed );
+				max = std::max( max, histogram.max.exchange( 0, std::memory_order_relaxed ) );
+			}
+
+			// Percentiles are the lower bounds of their buckets, never above the exact maximum
+			double const quantiles[] = { 0.5, 0.99 };
+			std::int64_t percentiles[] = { 0, 0 };
+			for ( int q = 0; q < 2; ++q )
+			{
+				std::uint64_t rank = ( std::uint64_t )( quantiles[ q ] * recordCount );
+				std::uint64_t seen = 0;
+				for ( int bucket = 0; bucket < BUCKET_COUNT && recordCount > 0; ++bucket )
+				{
+					seen += buckets[ bucket ];
+					if ( seen > rank )
+					{
+						percentiles[ q ] = std::min( getBucketValue( bucket ), max );
+						break;
+					}
+				}
+			}
+
+			char const *name = histograms.names[ i ];
+			std::fprintf( file, "%s.count %llu %lld\n", name, ( unsigned long long )recordCount, time );
+			std::fprintf( file, "%s.mean %.3f %lld\n", name, recordCount > 0 ? ( double )sum / recordCount : 0.0, time );
+			std::fprintf( file, "%s.p50 %lld %lld\n", name, ( long long )percentiles[ 0 ], time );
+			std::fprintf( file, "%s.p99 %lld %lld\n", name, ( long long )percentiles[ 1 ], time );
+			std::fprintf( file, "%s.max %lld %lld\n", name, ( long long )max, time );
+		}
+	}
+
+
+	//-------------------------------------------------------
+	void runWriter()
+	{
+		// The writer is a diagnostic, it may allocate during frames. Opening a pipe waits for its reader
+		memory::HeapScope heapScope;
+		FILE *file = std::fopen( writerPath, "w" );
+		if ( !file )
+		{
+			std::fprintf( stderr, "telemetry: can't open %s\n", writerPath );
+			return;
+		}
+
+		std::unique_lock< std::mutex > lock( writerMutex );
+		writerOpened = true;
+		Clock::time_point lastWrite = Clock::now();
+		Clock::time_point nextWrite = lastWrite + writerInterval;
+		for ( ;; )
+		{
+			bool stop = writerWakeUp.wait_until( lock, nextWrite, []{ return stopping; } );
+
+			Clock::time_point now = Clock::now();
+			long long time = ( long long )std::time( nullptr );
+			writeCounters( file, time, std::chrono::duration< double >( now - lastWrite ).count() );
+			writeGauges( file, time );
+			writeHistograms( file, time );
+			std::fflush( file );
+			if ( stop )
+				break;
+
+			// A late wake-up doesn't shift the following ones
+			lastWrite = now;
+			nextWrite += writerInterval;
+			if ( nextWrite < now )
+				nextWrite = now + writerInterval;
+		}
+		std::fclose( file );
+	}
+}
+
+
+//-------------------------------------------------------
+//	public telemetry interface
+//-------------------------------------------------------
+
+namespace telemetry
+{
+	//-------------------------------------------------------
+	Counter::Counter( char const *name ) :
+		index( registerMetric( counters, name ) )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void Counter::add( std::int64_t value ) const
+	{
+		getShard().counters[ index ].fetch_add( value, std::memory_order_relaxed );
+	}
+
+
+	//-------------------------------------------------------
+	Gauge::Gauge( char const *name ) :
+		index( registerMetric( gauges, name ) )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void Gauge::set( std::int64_t value ) const
+	{
+		gaugeValues[ index ].value.store( value, std::memory_order_relaxed );
+		raise( gaugeValues[ index ].peak, value );
+	}
+
+
+	//-------------------------------------------------------
+	Histogram::Histogram( char const *name ) :
+		index( registerMetric( histograms, name ) )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	void Histogram::record( std::int64_t value, std::int64_t count ) const
+	{
+		HistogramShard &histogram = getShard().histograms[ index ];
+		histogram.buckets[ getBucket( value ) ].fetch_add( ( std::uint32_t )count, std::memory_order_relaxed );
+		histogram.sum.fetch_add( value * count, std::memory_order_relaxed );
+		raise( histogram.max, value );
+	}
+
+
+	//-------------------------------------------------------
+	Timer::Timer( Histogram const &histogram ) :
+		histogram( histogram ),
+		begin( profiler::getTicks() )
+	{
+	}
+
+
+	//-------------------------------------------------------
+	Timer::~Timer()
+	{
+		// The tick frequency is known once the profiler is initialized
+		double frequency = profiler::getTickFrequency();
+		if ( frequency > 0.0 )
+			histogram.record( ( std::int64_t )( ( profiler::getTicks() - begin ) * ( 1e9 / frequency ) ) );
+	}
+
+
+	//-------------------------------------------------------
+	void init( char const *path, double interval )
+	{
+		if ( !path || writer.joinable() )
+			return;
+
+		writerPath = path;
+		writerInterval = std::chrono::duration_cast< Clock::duration >( std::chrono::duration< double >( interval > 0.0 ? interval : 1.0 ) );
+		stopping = false;
+		writerOpened = false;
+		writer = std::thread( runWriter );
+	}
+
+
+	//-------------------------------------------------------
+	void deinit()
+	{
+		if ( !writer.joinable() )
+			return;
+
+		bool opened;
+		{
+			std::lock_guard< std::mutex > lock( writerMutex );
+			stopping = true;
+			opened = writerOpened;
+		}
+		writerWakeUp.notify_one();
+
+		// A writer, which still waits for the reader of its pipe, is left to the end of the process
+		if ( opened )
+			writer.join();
+		else
+			writer.detach();
+	}
+}
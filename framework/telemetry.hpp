@@ -0,0 +1,91 @@
+//-------------------------------------------------------
+//	runtime telemetry
+//-------------------------------------------------------
+
+/*
+ * Counters, gauges and histograms of a running instance, written periodically as lines of text for graphing
+ *
+ * A metric is defined once and registered by its name, like a profiler scope:
+ *	telemetry::Counter const landings( "game.landings" );
+ *	landings.add( count );
+ * Counters and histograms are sharded per thread: a thread adds to its own cache lines with relaxed atomics,
+ * the writer sums the shards. A gauge keeps the last value set and the highest one since the start
+ * Recording never blocks or allocates, metrics are collected with or without init
+ *
+ * init starts a writer thread, which appends a block of lines to path every interval seconds and once more
+ * at deinit, in the Graphite plaintext format "name value unix_time":
+ *	counter		name total, name.rate per second over the interval
+ *	gauge		name last value, name.peak
+ *	histogram	name.count, name.mean, name.p50, name.p99, name.max over the interval, 0 when empty
+ * The path is opened by the writer thread, so a named pipe ( \\.\pipe\name on Windows, a FIFO elsewhere )
+ * streams the lines to a local collector without holding up the game until the collector connects
+ * Histogram percentiles are exact below 8 and within 25% above, every octave has 4 buckets
+ */
+
+#include <cstdint>
+
+
+namespace telemetry
+{
+	constexpr int MAX_COUNTERS = 64;
+	constexpr int MAX_GAUGES = 64;
+	constexpr int MAX_HISTOGRAMS = 16;
+
+
+	class Counter
+	{
+	public:
+		explicit Counter( char const *name );
+
+		void add( std::int64_t value = 1 ) const;
+
+	private:
+		int index;
+	};
+
+
+	class Gauge
+	{
+	public:
+		explicit Gauge( char const *name );
+
+		void set( std::int64_t value ) const;
+
+	private:
+		int index;
+	};
+
+
+	// Non-negative values, count records value as many times, for distributions gathered in local buckets first
+	class Histogram
+	{
+	public:
+		explicit Histogram( char const *name );
+
+		void record( std::int64_t value, std::int64_t count = 1 ) const;
+
+	private:
+		int index;
+	};
+
+
+	// Records the nanoseconds of the rest of the enclosing block into a histogram, on the profiler clock
+	class Timer
+	{
+	public:
+		explicit Timer( Histogram const &histogram );
+		~Timer();
+
+		Timer( Timer const & ) = delete;
+		Timer &operator = ( Timer const & ) = delete;
+
+	private:
+		Histogram const &histogram;
+		std::int64_t begin;
+	};
+
+
+	// Without a path nothing is written
+	void init( char const *path, double interval );
+	void deinit();
+}
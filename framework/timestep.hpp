@@ -0,0 +1,44 @@
+
+//-------------------------------------------------------
+//	fixed simulation timestep
+//-------------------------------------------------------
+
+// Splits variable frame times into a whole number of fixed simulation steps.
+// The time left after the last step is reported as the interpolation factor between the two
+// last simulated states. After a long frame at most maxSteps are simulated and the rest of the
+// time is dropped, so a hitch slows the game down for a moment instead of piling up more work.
+
+class FixedTimestep
+{
+public:
+	FixedTimestep( float step, int maxSteps ) :
+		step( step ),
+		maxSteps( maxSteps )
+	{
+	}
+
+	// Returns the number of steps to simulate for the frame
+	int advance( float frameTime )
+	{
+		accumulator += frameTime;
+		int steps = 0;
+		while ( accumulator >= step && steps < maxSteps )
+		{
+			accumulator -= step;
+			++steps;
+		}
+		if ( accumulator >= step )
+			accumulator = 0.0;
+		return steps;
+	}
+
+	float getStep() const { return step; }
+
+	// Position of the rendered frame between the previous and the last simulated states, [0, 1)
+	float getAlpha() const { return ( float )( accumulator / step ); }
+
+private:
+	float step;
+	int maxSteps;
+	double accumulator = 0.0;
+};
@@ -0,0 +1,574 @@
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <utility>
+
+#include "../framework/jobs.hpp"
+#include "../framework/memory.hpp"
+#include "aircraft_fleet.hpp"
+#include "steering_kernels.hpp"
+
+
+namespace
+{
+	// An aircraft closer to the ship forward axis is considered to be on it
+	constexpr float LANDING_AXIS_TOLERANCE = 0.01f;
+
+	// A landing step is entered at its distance threshold, but left back only this many times beyond it
+	constexpr float LANDING_STEP_HYSTERESIS = 1.5f;
+
+	/*
+	 * Landing geometry relative to the ship: the aircraft position is split into the components along
+	 * the ship forward axis and across it, so the intersection with the axis is a plain projection
+	 */
+	struct LandingGeometry
+	{
+		float along;
+		float across;
+	};
+
+	LandingGeometry get_landing_geometry(const Vector2 & position, const CarrierState & carrier)
+	{
+		Vector2 relative = position - carrier.position;
+		return LandingGeometry{
+			relative.x * carrier.forward.x + relative.y * carrier.forward.y,
+			relative.x * carrier.normal.x + relative.y * carrier.normal.y };
+	}
+
+	template <class Traits>
+	LandingStep advance_landing_step(LandingStep step, float axis_distance)
+	{
+		// The stored step is kept while the aircraft stays in its band, so an aircraft close to a threshold
+		// doesn't flip between two steps every frame
+		constexpr float RADIUS = AircraftFleet<Traits>::LANDING_RADIUS;
+		switch (step) {
+		case LANDING_APPROACH:
+			if (axis_distance > RADIUS)
+				return LANDING_APPROACH;
+			return axis_distance > LANDING_AXIS_TOLERANCE ? LANDING_ALIGN : LANDING_FINAL;
+		case LANDING_ALIGN:
+			if (axis_distance > RADIUS * LANDING_STEP_HYSTERESIS)
+				return LANDING_APPROACH;
+			return axis_distance > LANDING_AXIS_TOLERANCE ? LANDING_ALIGN : LANDING_FINAL;
+		default:
+			if (axis_distance <= LANDING_AXIS_TOLERANCE * LANDING_STEP_HYSTERESIS)
+				return LANDING_FINAL;
+			return axis_distance > RADIUS * LANDING_STEP_HYSTERESIS ? LANDING_APPROACH : LANDING_ALIGN;
+		}
+	}
+
+	template <class Traits>
+	Vector2 calculate_landing_destination(LandingStep step, const LandingGeometry & geometry, const CarrierState & carrier)
+	{
+		float across_sign = geometry.across >= 0.f ? 1.f : -1.f;
+		float along_sign = geometry.along >= 0.f ? 1.f : -1.f;
+
+		switch (step) {
+		case LANDING_APPROACH:
+			// Step 1 - go close to the ship forward vector normal (TARGET_RADIUS based component is used to get smooth rotation)
+			return (across_sign * AircraftFleet<Traits>::LANDING_RADIUS - geometry.across) * carrier.normal;
+		case LANDING_ALIGN:
+			// Step 2 - rotate to be in the ship forward vector
+			return -geometry.across * carrier.normal - along_sign * AircraftFleet<Traits>::LANDING_RADIUS * carrier.forward;
+		default:
+			// Step 3 - got to the ship
+			return -geometry.along * carrier.forward - geometry.across * carrier.normal;
+		}
+	}
+}
+
+template <class Traits>
+AircraftFleet<Traits>::AircraftFleet(std::size_t reserve, std::uint32_t timer_group) :
+	m_timer_group(timer_group),
+	m_grid(make_world_grid(GRID_CELL_SIZE))
+{
+	this->reserve(reserve);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::reserve(std::size_t count)
+{
+	m_meshes.reserve(count);
+	m_ids.reserve(count);
+	m_carriers.reserve(count);
+	m_position_x.reserve(count);
+	m_position_y.reserve(count);
+	m_angles.reserve(count);
+	m_heading_x.reserve(count);
+	m_heading_y.reserve(count);
+	m_velocity_x.reserve(count);
+	m_velocity_y.reserve(count);
+	m_landing_steps.reserve(count);
+	m_bidders.reserve(count);
+	m_trail_timeouts.reserve(count);
+	m_id_slots.reserve(count);
+	m_grid.reserve(count);
+}
+
+template <class Traits>
+AircraftFleet<Traits>::~AircraftFleet()
+{
+	clear();
+}
+
+template <class Traits>
+std::uint32_t AircraftFleet<Traits>::allocate_id(std::uint32_t index)
+{
+	if (m_free_ids == NO_ID) {
+		m_id_slots.push_back(IdSlot{ 0, index });
+		return static_cast<std::uint32_t>(m_id_slots.size() - 1);
+	}
+
+	std::uint32_t id = m_free_ids;
+	m_free_ids = m_id_slots[id].index;
+	m_id_slots[id].index = index;
+	return id;
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::free_id(std::uint32_t id)
+{
+	// The new generation invalidates timer events, which are still scheduled for the old aircraft
+	++m_id_slots[id].generation;
+	m_id_slots[id].index = m_free_ids;
+	m_free_ids = id;
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::swap_aircrafts(std::size_t lhv, std::size_t rhv)
+{
+	if (lhv == rhv) {
+		return;
+	}
+
+	std::swap(m_meshes[lhv], m_meshes[rhv]);
+	std::swap(m_ids[lhv], m_ids[rhv]);
+	std::swap(m_carriers[lhv], m_carriers[rhv]);
+	std::swap(m_position_x[lhv], m_position_x[rhv]);
+	std::swap(m_position_y[lhv], m_position_y[rhv]);
+	std::swap(m_angles[lhv], m_angles[rhv]);
+	std::swap(m_heading_x[lhv], m_heading_x[rhv]);
+	std::swap(m_heading_y[lhv], m_heading_y[rhv]);
+	std::swap(m_velocity_x[lhv], m_velocity_x[rhv]);
+	std::swap(m_velocity_y[lhv], m_velocity_y[rhv]);
+	std::swap(m_landing_steps[lhv], m_landing_steps[rhv]);
+	std::swap(m_bidders[lhv], m_bidders[rhv]);
+	std::swap(m_trail_timeouts[lhv], m_trail_timeouts[rhv]);
+
+	m_id_slots[m_ids[lhv]].index = static_cast<std::uint32_t>(lhv);
+	m_id_slots[m_ids[rhv]].index = static_cast<std::uint32_t>(rhv);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::pop_aircraft()
+{
+	m_meshes.pop_back();
+	m_ids.pop_back();
+	m_carriers.pop_back();
+	m_position_x.pop_back();
+	m_position_y.pop_back();
+	m_angles.pop_back();
+	m_heading_x.pop_back();
+	m_heading_y.pop_back();
+	m_velocity_x.pop_back();
+	m_velocity_y.pop_back();
+	m_landing_steps.pop_back();
+	m_bidders.pop_back();
+	m_trail_timeouts.pop_back();
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::launch(std::uint32_t carrier, const Vector2 & position, float angle, TimerWheel & timers)
+{
+	std::size_t index = m_meshes.size();
+	std::uint32_t id = allocate_id(static_cast<std::uint32_t>(index));
+
+	m_meshes.push_back(scene::createAircraftMesh());
+	m_ids.push_back(id);
+	m_carriers.push_back(carrier);
+	m_position_x.push_back(position.x);
+	m_position_y.push_back(position.y);
+	m_angles.push_back(angle);
+	m_heading_x.push_back(std::cos(angle));
+	m_heading_y.push_back(std::sin(angle));
+	m_velocity_x.push_back(0.f);
+	m_velocity_y.push_back(0.f);
+	m_landing_steps.push_back(LANDING_APPROACH);
+	m_bidders.push_back(0);
+	m_trail_timeouts.push_back(0.f);
+
+	// The new aircraft joins the end of the taxi group, the first aircrafts of the next groups move to their ends
+	swap_aircrafts(m_patrol_end, index);
+	swap_aircrafts(m_taxi_end, m_patrol_end);
+	++m_taxi_end;
+	++m_patrol_end;
+
+	const std::uint32_t generation = m_id_slots[id].generation;
+	timers.schedule(Traits::TAKEOFF_TIME, TIMER_AIRCRAFT_TAKEOFF, id, generation, m_timer_group);
+	timers.schedule(Traits::LIVE_TIME, TIMER_AIRCRAFT_RETURN, id, generation, m_timer_group);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::clear()
+{
+	for (scene::Mesh * mesh : m_meshes) {
+		scene::destroyMesh(mesh);
+	}
+	for (std::uint32_t id : m_ids) {
+		free_id(id);
+	}
+	m_meshes.clear();
+	m_ids.clear();
+	m_carriers.clear();
+	m_position_x.clear();
+	m_position_y.clear();
+	m_angles.clear();
+	m_heading_x.clear();
+	m_heading_y.clear();
+	m_velocity_x.clear();
+	m_velocity_y.clear();
+	m_landing_steps.clear();
+	m_bidders.clear();
+	m_trail_timeouts.clear();
+	m_taxi_end = 0;
+	m_patrol_end = 0;
+	m_grid.build(nullptr, nullptr, 0);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::handle_timer(const TimerEvent & event, GoalAssignment & assignment)
+{
+	assert(event.group == m_timer_group);
+	if (event.target >= m_id_slots.size() || m_id_slots[event.target].generation != event.generation) {
+		return;
+	}
+
+	// The aircraft is swapped with the last one of its group, then the boundary moves over it
+	std::size_t index = m_id_slots[event.target].index;
+	switch (event.type) {
+	case TIMER_AIRCRAFT_TAKEOFF:
+		assert(index < m_taxi_end);
+		swap_aircrafts(index, m_taxi_end - 1);
+		--m_taxi_end;
+		m_bidders[m_taxi_end] = assignment.add(Vector2(m_position_x[m_taxi_end], m_position_y[m_taxi_end]));
+		break;
+
+	case TIMER_AIRCRAFT_RETURN:
+		assert(index >= m_taxi_end && index < m_patrol_end);
+		swap_aircrafts(index, m_patrol_end - 1);
+		--m_patrol_end;
+		m_landing_steps[m_patrol_end] = LANDING_APPROACH;
+		assignment.remove(m_bidders[m_patrol_end]);
+		break;
+
+	default:
+		assert(!"not an aircraft timer");
+		break;
+	}
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::update(float dt, const std::vector<CarrierState> & carriers, const SpatialGrid & carrier_grid,
+	GoalAssignment & assignment, std::vector<std::uint32_t> & landed)
+{
+	remove_landed(carrier_grid, landed);
+	const std::size_t count = m_meshes.size();
+
+	m_destination_x = memory::allocateFrameArray<float>(count);
+	m_destination_y = memory::allocateFrameArray<float>(count);
+	m_steering_mask = memory::allocateFrameArray<float>(count);
+	m_goal_x = memory::allocateFrameArray<float>(count);
+	m_goal_y = memory::allocateFrameArray<float>(count);
+	m_trail_x = memory::allocateFrameArray<float>(count);
+	m_trail_y = memory::allocateFrameArray<float>(count);
+	const std::size_t chunk_count = (count + UPDATE_CHUNK_SIZE - 1) / UPDATE_CHUNK_SIZE;
+	m_trail_counts = memory::allocateFrameArray<int>(chunk_count);
+
+	// Aircrafts don't interact with each other, so the fleet is updated in independent chunks
+	jobs::parallelFor(static_cast<int>(count), UPDATE_CHUNK_SIZE, [&](int begin, int end) {
+		update_range(dt, carriers, assignment, begin, end);
+	});
+
+	// The only sync point of the trails: blocks are handed to the scene in chunk order, whichever thread filled them
+	for (std::size_t chunk = 0; chunk < chunk_count; ++chunk) {
+		const std::size_t begin = chunk * UPDATE_CHUNK_SIZE;
+		scene::emitTrails(m_trail_x + begin, m_trail_y + begin, m_trail_counts[chunk]);
+	}
+
+	m_grid.build(m_position_x.data(), m_position_y.data(), count);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::update_range(float dt, const std::vector<CarrierState> & carriers, GoalAssignment & assignment, std::size_t begin, std::size_t end)
+{
+	const std::size_t taxi_end = std::min(std::max(m_taxi_end, begin), end);
+	const std::size_t patrol_end = std::min(std::max(m_patrol_end, begin), end);
+
+	SteeringParams steering;
+	steering.linear_speed = Traits::LINEAR_SPEED;
+	steering.landing_radius = LANDING_RADIUS;
+	steering.landing_speed = Traits::LANDING_SPEED;
+	steering.max_rotation = Traits::ANGULAR_SPEED * dt;
+	steering.acceleration = Traits::LINEAR_ACCELERATION * dt;
+	steering.rotation_cos = std::cos(steering.max_rotation);
+	steering.rotation_sin = std::sin(steering.max_rotation);
+	steering.dt = dt;
+	steering.target_radius = Traits::TARGET_RADIUS;
+
+	auto make_batch = [this](std::size_t first, std::size_t last) {
+		SteeringBatch batch;
+		batch.count = last - first;
+		batch.destination_x = m_destination_x + first;
+		batch.destination_y = m_destination_y + first;
+		batch.steering_mask = m_steering_mask + first;
+		batch.goal_x = m_goal_x + first;
+		batch.goal_y = m_goal_y + first;
+		batch.angle = m_angles.data() + first;
+		batch.heading_x = m_heading_x.data() + first;
+		batch.heading_y = m_heading_y.data() + first;
+		batch.velocity_x = m_velocity_x.data() + first;
+		batch.velocity_y = m_velocity_y.data() + first;
+		batch.position_x = m_position_x.data() + first;
+		batch.position_y = m_position_y.data() + first;
+		return batch;
+	};
+
+	const SteeringKernels & kernels = get_steering_kernels();
+
+	// At the beginning of the flight we should to block own aircraft rotation to run to the runway
+	for (std::size_t i = begin; i < taxi_end; ++i) {
+		const CarrierState & carrier = carriers[m_carriers[i]];
+		Vector2 position(m_position_x[i], m_position_y[i]);
+
+		m_velocity_x[i] = m_velocity_x[i] + carrier.delta_velocity.x;
+		m_velocity_y[i] = m_velocity_y[i] + carrier.delta_velocity.y;
+
+		m_angles[i] = carrier.angle;
+		m_heading_x[i] = carrier.forward.x;
+		m_heading_y[i] = carrier.forward.y;
+
+		Vector2 relative = position - carrier.position;
+		position = Vector2(carrier.delta_cos * relative.x - carrier.delta_sin * relative.y,
+			carrier.delta_sin * relative.x + carrier.delta_cos * relative.y) + carrier.position;
+		m_position_x[i] = position.x;
+		m_position_y[i] = position.y;
+	}
+
+	// Every bidder is written by its own chunk only, the assignment isn't solved during the update
+	for (std::size_t i = taxi_end; i < patrol_end; ++i) {
+		assignment.set_position(m_bidders[i], Vector2(m_position_x[i], m_position_y[i]));
+		const Vector2 & goal = assignment.get_goal(assignment.get_goal_of(m_bidders[i]));
+		m_goal_x[i] = goal.x;
+		m_goal_y[i] = goal.y;
+	}
+
+	// Patrol destinations depend on the positions and goals only, they are computed as a batch too
+	kernels.orbit(steering, make_batch(taxi_end, patrol_end), m_destination_x + taxi_end, m_destination_y + taxi_end);
+	std::fill(m_steering_mask + taxi_end, m_steering_mask + patrol_end, 1.f);
+
+	for (std::size_t i = patrol_end; i < end; ++i) {
+		const CarrierState & carrier = carriers[m_carriers[i]];
+		LandingGeometry geometry = get_landing_geometry(Vector2(m_position_x[i], m_position_y[i]), carrier);
+
+		// Distance to the axis advances the stored step, drifting far off the axis takes the aircraft a step back
+		m_landing_steps[i] = advance_landing_step<Traits>(m_landing_steps[i], std::abs(geometry.across));
+
+		Vector2 destination = calculate_landing_destination<Traits>(m_landing_steps[i], geometry, carrier);
+		m_destination_x[i] = destination.x;
+		m_destination_y[i] = destination.y;
+		m_steering_mask[i] = 1.f;
+	}
+
+	// Batch part: rotation of the flying aircrafts and velocity integration for the whole chunk
+	kernels.steer(steering, make_batch(taxi_end, end));
+	kernels.integrate(steering, make_batch(begin, end));
+
+	for (std::size_t i = begin; i < end; ++i) {
+		scene::placeMesh(m_meshes[i], m_position_x[i], m_position_y[i], m_angles[i]);
+	}
+
+	// Trail particles of the chunk go to its own block, the chunk range of the trail arrays, so workers
+	// never share a write. Every aircraft is written to the block, only the emitting ones advance it
+	std::size_t trail_end = begin;
+	for (std::size_t i = begin; i < end; ++i) {
+		const bool emits = m_trail_timeouts[i] - dt <= 0.f;
+		m_trail_timeouts[i] = m_trail_timeouts[i] - dt + (emits ? params::aircraft::TRAIL_INTERVAL : 0.f);
+		m_trail_x[trail_end] = m_position_x[i];
+		m_trail_y[trail_end] = m_position_y[i];
+		trail_end += emits ? 1 : 0;
+	}
+	m_trail_counts[begin / UPDATE_CHUNK_SIZE] = static_cast<int>(trail_end - begin);
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::save(SnapshotWriter & snapshot) const
+{
+	snapshot.write(static_cast<std::uint64_t>(m_taxi_end));
+	snapshot.write(static_cast<std::uint64_t>(m_patrol_end));
+	snapshot.write_array(m_ids);
+	snapshot.write_array(m_carriers);
+	snapshot.write_array(m_position_x);
+	snapshot.write_array(m_position_y);
+	snapshot.write_array(m_angles);
+	snapshot.write_array(m_heading_x);
+	snapshot.write_array(m_heading_y);
+	snapshot.write_array(m_velocity_x);
+	snapshot.write_array(m_velocity_y);
+	snapshot.write_array(m_landing_steps);
+	snapshot.write_array(m_bidders);
+	snapshot.write_array(m_id_slots);
+	snapshot.write(m_free_ids);
+}
+
+template <class Traits>
+bool AircraftFleet<Traits>::restore(SnapshotReader & snapshot, std::size_t carrier_count, const GoalAssignment & assignment,
+	const TimerWheel & timers)
+{
+	clear();
+
+	std::uint64_t taxi_end = 0;
+	std::uint64_t patrol_end = 0;
+	snapshot.read(taxi_end);
+	snapshot.read(patrol_end);
+	snapshot.read_array(m_ids);
+	const std::size_t count = m_ids.size();
+	snapshot.read_array(m_carriers, count);
+	snapshot.read_array(m_position_x, count);
+	snapshot.read_array(m_position_y, count);
+	snapshot.read_array(m_angles, count);
+	snapshot.read_array(m_heading_x, count);
+	snapshot.read_array(m_heading_y, count);
+	snapshot.read_array(m_velocity_x, count);
+	snapshot.read_array(m_velocity_y, count);
+	snapshot.read_array(m_landing_steps, count);
+	snapshot.read_array(m_bidders, count);
+	snapshot.read_array(m_id_slots);
+	snapshot.read(m_free_ids);
+
+	// Every array has to hold an element per aircraft, the groups have to be in order
+	bool valid = snapshot.is_valid() && taxi_end <= patrol_end && patrol_end <= count;
+	for (const std::vector<float> * array : { &m_position_x, &m_position_y, &m_angles, &m_heading_x, &m_heading_y, &m_velocity_x, &m_velocity_y }) {
+		valid = valid && array->size() == count;
+	}
+	valid = valid && m_carriers.size() == count && m_landing_steps.size() == count && m_bidders.size() == count;
+	if (valid) {
+		m_taxi_end = static_cast<std::size_t>(taxi_end);
+		m_patrol_end = static_cast<std::size_t>(patrol_end);
+		valid = is_consistent(carrier_count, assignment, timers);
+	}
+	if (!valid) {
+		// Nothing refers to the restored ids yet, they are dropped with the rest
+		m_ids.clear();
+		m_id_slots.clear();
+		m_free_ids = NO_ID;
+		clear();
+		return false;
+	}
+
+	m_trail_timeouts.assign(count, 0.f);
+	for (std::size_t i = 0; i < count; ++i) {
+		m_meshes.push_back(scene::createAircraftMesh());
+		scene::placeMesh(m_meshes[i], m_position_x[i], m_position_y[i], m_angles[i]);
+	}
+	m_grid.build(m_position_x.data(), m_position_y.data(), count);
+	return true;
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::count_references(std::vector<std::uint32_t> & carrier_counts, std::vector<std::uint32_t> & bidder_counts) const
+{
+	for (std::size_t i = 0; i < m_carriers.size(); ++i) {
+		++carrier_counts[m_carriers[i]];
+	}
+	for (std::size_t i = m_taxi_end; i < m_patrol_end; ++i) {
+		++bidder_counts[m_bidders[i]];
+	}
+}
+
+template <class Traits>
+bool AircraftFleet<Traits>::is_consistent(std::size_t carrier_count, const GoalAssignment & assignment, const TimerWheel & timers) const
+{
+	// Aircrafts and their id slots refer to each other, the other slots form the free list, each slot is used once
+	const std::size_t count = m_ids.size();
+	std::vector<bool> used(m_id_slots.size(), false);
+	for (std::size_t i = 0; i < count; ++i) {
+		const std::uint32_t id = m_ids[i];
+		if (id >= m_id_slots.size() || used[id] || m_id_slots[id].index != i || m_carriers[i] >= carrier_count ||
+			m_landing_steps[i] > LANDING_FINAL) {
+			return false;
+		}
+		if (i >= m_taxi_end && i < m_patrol_end && !assignment.is_active(m_bidders[i])) {
+			return false;
+		}
+		used[id] = true;
+	}
+
+	std::size_t free_count = 0;
+	for (std::uint32_t id = m_free_ids; id != NO_ID; id = m_id_slots[id].index) {
+		if (id >= m_id_slots.size() || used[id]) {
+			return false;
+		}
+		used[id] = true;
+		++free_count;
+	}
+	if (count + free_count != m_id_slots.size()) {
+		return false;
+	}
+
+	// Events of the current id generations act on the aircrafts: a taxiing aircraft waits for its takeoff
+	// and then for its return, a patrolling one for its return only, a returning one for nothing
+	std::vector<double> takeoff_times(count, -1.0);
+	std::vector<double> return_times(count, -1.0);
+	bool valid = true;
+	timers.for_each_event([&](const TimerEvent & event) {
+		if (event.type == TIMER_CARRIER_REFILL || event.group != m_timer_group || event.target >= m_id_slots.size() ||
+			m_id_slots[event.target].generation != event.generation) {
+			return;
+		}
+
+		const std::uint32_t index = m_id_slots[event.target].index;
+		std::vector<double> * times = event.type == TIMER_AIRCRAFT_TAKEOFF ? &takeoff_times
+			: event.type == TIMER_AIRCRAFT_RETURN ? &return_times
+			: nullptr;
+		if (!times || index >= count || m_ids[index] != event.target || (*times)[index] >= 0.0 || !(event.time >= 0.0)) {
+			valid = false;
+			return;
+		}
+		(*times)[index] = event.time;
+	});
+	for (std::size_t i = 0; valid && i < count; ++i) {
+		const bool taxiing = i < m_taxi_end;
+		const bool patrolling = !taxiing && i < m_patrol_end;
+		valid = (takeoff_times[i] >= 0.0) == taxiing && (return_times[i] >= 0.0) == (taxiing || patrolling) &&
+			(!taxiing || takeoff_times[i] < return_times[i]);
+	}
+	return valid;
+}
+
+template <class Traits>
+void AircraftFleet<Traits>::remove_landed(const SpatialGrid & carrier_grid, std::vector<std::uint32_t> & landed)
+{
+	// Only returning aircrafts can land, they are the last group: removal moves the last aircraft into the freed place
+	for (std::size_t i = m_patrol_end; i < m_meshes.size();) {
+		// delete airplane if it close enought for ship
+		if (carrier_grid.find_nearest(Vector2(m_position_x[i], m_position_y[i]), params::ship::SIZE) != m_carriers[i]) {
+			++i;
+			continue;
+		}
+
+		scene::destroyMesh(m_meshes[i]);
+		++landed[m_carriers[i]];
+
+		// The moved aircraft is checked on the next iteration, at the same index
+		std::uint32_t id = m_ids[i];
+		swap_aircrafts(i, m_meshes.size() - 1);
+		pop_aircraft();
+		free_id(id);
+	}
+}
+
+template class AircraftFleet<params::aircraft::Fighter>;
+template class AircraftFleet<params::aircraft::Bomber>;
+template class AircraftFleet<params::aircraft::Scout>;
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../framework/scene.hpp"
+#include "goal_assignment.hpp"
+#include "params.hpp"
+#include "snapshot.hpp"
+#include "spatial_grid.hpp"
+#include "timer_wheel.hpp"
+#include "vector2.hpp"
+
+
+template <class Traits>
+constexpr float calculate_landing_radius()
+{
+	// In worst case, aircraft is located in opposite direction from decreasing the speed
+	// So we need to rotate on 180 degrees
+	constexpr float ROTATION_TIME = M_PI / Traits::ANGULAR_SPEED;
+	constexpr float SLOWDOWN_TIME = (Traits::LINEAR_SPEED - Traits::LANDING_SPEED) / Traits::LINEAR_ACCELERATION;
+
+	// During rotation, aircraft doesn't change its velocity (or it's needed to turn off lateral speed)
+	// So, in worst case aircaft flight with LINEAR_SPEED for ROTATION_TIME
+	constexpr float ROTATION_TRAVEL = ROTATION_TIME * Traits::LINEAR_SPEED;
+
+	// Here the aircraft slows down its speed, so we need to calculate simple integral
+	constexpr float SLOWDOWN_TRAVEL = (Traits::LINEAR_SPEED - Traits::LANDING_SPEED) * SLOWDOWN_TIME / 2.f;
+
+	return ROTATION_TRAVEL + SLOWDOWN_TRAVEL;
+}
+
+/*
+ * Carrier state, which is shared by all its aircrafts during one update
+ * Ship gathers it once per frame, so aircrafts don't need to access the ship itself
+ */
+struct CarrierState
+{
+	Vector2 position;
+	float angle;
+
+	// Ship basis, computed once per frame for all landing aircrafts: the runway axis and its left normal
+	Vector2 forward;
+	Vector2 normal;
+
+	// Ship movement during this frame, aircrafts on the runway are moved together with the ship
+	// The rotation is also given as its cos and sin, so runway aircrafts are rotated without trigonometry
+	float delta_rotation;
+	float delta_cos;
+	float delta_sin;
+	Vector2 delta_velocity;
+};
+
+// Landing step of a returning aircraft, kept with the aircraft for inspection and snapshots
+enum LandingStep : std::uint8_t
+{
+	LANDING_APPROACH,	// go close to the ship forward axis
+	LANDING_ALIGN,		// turn along the axis
+	LANDING_FINAL,		// on the axis, go to the ship
+};
+
+/*
+ * Aircrafts of all carriers, stored as parallel arrays, every aircraft refers to its home carrier by index
+ * Every update advances the whole fleet in a few linear passes: landing destinations are chosen per aircraft,
+ * patrol destinations, rotation and velocity integration run as batch kernels (see steering_kernels.hpp)
+ * Carrier states are gathered once per update, so aircrafts don't need to access the ships themselves
+ *
+ * Aircrafts are grouped by flight phase: [0, taxi_end) run along the runway, [taxi_end, patrol_end) patrol
+ * around their goals, [patrol_end, size) return to the carrier. Patrolling aircrafts are the bidders of
+ * the goal assignment, they join it at takeoff and leave it at return. Phase changes are timer events, each one moves
+ * an aircraft over a group boundary in O(1), and every group is updated by its own loop without phase checks
+ * Timer events refer to aircrafts by ids, which stay valid while aircrafts are moved between groups
+ *
+ * The fleet holds aircrafts of one class, Traits is one of params::aircraft classes: every class gets its own
+ * update loops with the class constants folded in. Members are defined in aircraft_fleet.cpp and instantiated
+ * there for every class, timer_group tells apart the timer events of different class fleets
+ */
+template <class Traits>
+class AircraftFleet
+{
+public:
+	static constexpr float LANDING_RADIUS = calculate_landing_radius<Traits>();
+
+	AircraftFleet(std::size_t reserve, std::uint32_t timer_group);
+	~AircraftFleet();
+
+	AircraftFleet(const AircraftFleet &) = delete;
+	AircraftFleet & operator = (const AircraftFleet &) = delete;
+
+	std::size_t size() const { return m_meshes.size(); }
+	void reserve(std::size_t count);
+
+	// Schedules the takeoff and return of the new aircraft in timers
+	void launch(std::uint32_t carrier, const Vector2 & position, float angle, TimerWheel & timers);
+
+	// Removes the aircrafts only, their bidders are left to clearing the assignment
+	void clear();
+
+	// Applies TIMER_AIRCRAFT_* events of timer_group, events of aircrafts, which already landed, are ignored
+	void handle_timer(const TimerEvent & event, GoalAssignment & assignment);
+
+	// carriers and carrier_grid are indexed by carrier, the grid is built from the same positions
+	// Patrolling aircrafts orbit the goals assigned to them and give the assignment their new positions
+	// A returning aircraft lands when its carrier is the nearest one in reach: it is removed from the fleet
+	// and counted in landed[carrier]. Trail particles of all aircrafts are handed to the scene at the end
+	void update(float dt, const std::vector<CarrierState> & carriers, const SpatialGrid & carrier_grid,
+		GoalAssignment & assignment, std::vector<std::uint32_t> & landed);
+
+	// Aircraft arrays and ids as is, the meshes are created anew. The bidder handles refer to the assignment
+	// saved along with the fleet. Reserve the fleet before restoring, restore itself only allocates beyond that
+	// Restore checks the aircrafts against the restored carrier count, assignment and timers: every index
+	// has to be in range, and every aircraft has to have the events of its group pending
+	void save(SnapshotWriter & snapshot) const;
+	bool restore(SnapshotReader & snapshot, std::size_t carrier_count, const GoalAssignment & assignment, const TimerWheel & timers);
+
+	// Adds every aircraft to the count of its carrier and every patrolling one to the count of its bidder,
+	// so the owner can check that the fleets agree with each other and with the carriers
+	void count_references(std::vector<std::uint32_t> & carrier_counts, std::vector<std::uint32_t> & bidder_counts) const;
+
+	// Calls function(position, distance_squared) for every aircraft within radius from center,
+	// positions are the ones from the end of the last update
+	template <class Function>
+	void for_each_neighbour(const Vector2 & center, float radius, Function && function) const;
+
+private:
+	// Multiple of every kernel width, so chunk boundaries never change which kernel code handles an aircraft
+	static constexpr int UPDATE_CHUNK_SIZE = 512;
+
+	// Aircraft neighbour queries are short range, a cell is about a quarter of the orbit radius
+	static constexpr float GRID_CELL_SIZE = 0.5f;
+
+	static constexpr std::uint32_t NO_ID = ~std::uint32_t(0);
+
+	struct IdSlot
+	{
+		std::uint32_t generation;
+		std::uint32_t index;	// index in the arrays, or the next free id for a free slot
+	};
+
+	std::uint32_t allocate_id(std::uint32_t index);
+	void free_id(std::uint32_t id);
+	void swap_aircrafts(std::size_t lhv, std::size_t rhv);
+	void pop_aircraft();
+
+	void remove_landed(const SpatialGrid & carrier_grid, std::vector<std::uint32_t> & landed);
+	void update_range(float dt, const std::vector<CarrierState> & carriers, GoalAssignment & assignment, std::size_t begin, std::size_t end);
+	bool is_consistent(std::size_t carrier_count, const GoalAssignment & assignment, const TimerWheel & timers) const;
+
+	std::vector<scene::Mesh*> m_meshes;
+	std::vector<std::uint32_t> m_ids;
+	std::vector<std::uint32_t> m_carriers;
+	std::vector<float> m_position_x;
+	std::vector<float> m_position_y;
+	std::vector<float> m_angles;
+	std::vector<float> m_heading_x;	// unit vector of the angle, maintained by the steering kernels
+	std::vector<float> m_heading_y;
+	std::vector<float> m_velocity_x;
+	std::vector<float> m_velocity_y;
+	std::vector<LandingStep> m_landing_steps;	// valid for returning aircrafts only
+	std::vector<std::uint32_t> m_bidders;	// goal assignment handles, valid for patrolling aircrafts only
+	std::vector<float> m_trail_timeouts;	// time to the next trail particle, visual only and not saved
+
+	const std::uint32_t m_timer_group;
+
+	std::size_t m_taxi_end = 0;
+	std::size_t m_patrol_end = 0;
+
+	std::vector<IdSlot> m_id_slots;
+	std::uint32_t m_free_ids = NO_ID;
+
+	// Per-update scratch arrays for the steering kernels, in frame memory
+	float * m_destination_x = nullptr;
+	float * m_destination_y = nullptr;
+	float * m_steering_mask = nullptr;
+	float * m_goal_x = nullptr;
+	float * m_goal_y = nullptr;
+
+	// Trail particle blocks, one per update chunk in its range of the arrays, and their particle counts
+	float * m_trail_x = nullptr;
+	float * m_trail_y = nullptr;
+	int * m_trail_counts = nullptr;
+
+	SpatialGrid m_grid;
+};
+
+template <class Traits>
+constexpr float AircraftFleet<Traits>::LANDING_RADIUS;
+
+template <class Traits>
+template <class Function>
+void AircraftFleet<Traits>::for_each_neighbour(const Vector2 & center, float radius, Function && function) const
+{
+	m_grid.for_each_within(center, radius, [&](std::size_t index, float distance_squared) {
+		function(Vector2(m_position_x[index], m_position_y[index]), distance_squared);
+	});
+}
@@ -0,0 +1,407 @@
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <utility>
+
+#include "../framework/game.hpp"
+#include "../framework/telemetry.hpp"
+#include "carrier_pool.hpp"
+#include "params.hpp"
+
+
+namespace
+{
+	constexpr std::uint8_t get_key_bit(int key)
+	{
+		return static_cast<std::uint8_t>(1u << key);
+	}
+
+	// Carriers don't need finer cells, a cell is a few ship sizes
+	constexpr float GRID_CELL_SIZE = 1.f;
+
+	// Lifecycle times are seconds long, a tick only needs to be about a frame
+	constexpr float TIMER_TICK = 1.f / 64.f;
+
+	// Goal values evaluated by the assignment per update, about half a millisecond: new aircrafts get
+	// their slots at once, a restart after a goal move takes a few dozen updates for 5000 aircrafts
+	constexpr std::size_t ASSIGNMENT_EVALUATIONS = 1 << 17;
+
+	// Carriers by the number of their aircrafts in flight, recorded every update: the distribution over an interval
+	const telemetry::Histogram s_carrier_aircraft("game.carrier_aircraft");
+	const telemetry::Gauge s_carrier_gauge("game.carriers");
+	const telemetry::Gauge s_aircraft_gauge("game.aircraft");
+	const telemetry::Gauge s_refill_gauge("game.refills");	// landed aircrafts waiting for the refill
+	const telemetry::Counter s_landing_counter("game.landings");
+
+	// Centers of a columns x rows partition of the visible world area, a single one is the center
+	Vector2 get_spread_position(std::size_t index, std::size_t count)
+	{
+		if (count == 1) {
+			return Vector2(0.f, 0.f);
+		}
+
+		std::size_t columns = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<float>(count))));
+		std::size_t rows = (count + columns - 1) / columns;
+		Vector2 position((index % columns + 0.5f) / columns, (index / columns + 0.5f) / rows);
+		scene::unitToWorld(&position.x, &position.y);
+		return position;
+	}
+}
+
+static_assert(game::KEY_COUNT <= 8, "carrier input is stored as a byte of key bits");
+
+CarrierPool::CarrierPool(std::size_t reserve) :
+	m_timers(TIMER_TICK),
+	m_grid(make_world_grid(GRID_CELL_SIZE)),
+	m_fighters(0, AIRCRAFT_FIGHTER),
+	m_bombers(0, AIRCRAFT_BOMBER),
+	m_scouts(0, AIRCRAFT_SCOUT)
+{
+	this->reserve(reserve);
+}
+
+void CarrierPool::reserve(std::size_t count)
+{
+	// Every aircraft of a carrier has up to the takeoff and return events pending, a refill has one
+	const std::size_t aircraft_count = count * params::ship::AIRCRAFT_CAPACITY;
+	m_meshes.reserve(count);
+	m_position_x.reserve(count);
+	m_position_y.reserve(count);
+	m_angles.reserve(count);
+	m_forward_x.reserve(count);
+	m_forward_y.reserve(count);
+	m_inputs.reserve(count);
+	m_aircraft_counts.reserve(count);
+	m_refill_counts.reserve(count);
+	m_next_classes.reserve(count);
+	m_states.reserve(count);
+	m_landed.reserve(count);
+	m_grid.reserve(count);
+	m_timers.reserve(2 * aircraft_count);
+	m_due_timers.reserve(m_timers.get_capacity());
+	for_each_fleet([=](auto & fleet) { fleet.reserve(aircraft_count); });
+}
+
+CarrierPool::~CarrierPool()
+{
+	deinit();
+}
+
+bool CarrierPool::find_aircraft_class(const char * name, AircraftClass & aircraft_class)
+{
+	const std::pair<const char *, AircraftClass> NAMES[] = {
+		{ params::aircraft::Fighter::NAME, AIRCRAFT_FIGHTER },
+		{ params::aircraft::Bomber::NAME, AIRCRAFT_BOMBER },
+		{ params::aircraft::Scout::NAME, AIRCRAFT_SCOUT },
+		{ "mixed", AIRCRAFT_MIXED },
+	};
+
+	for (const auto & entry : NAMES) {
+		if (std::strcmp(name, entry.first) == 0) {
+			aircraft_class = entry.second;
+			return true;
+		}
+	}
+	return false;
+}
+
+void CarrierPool::init(std::size_t count, AircraftClass launch_class, std::size_t goal_count)
+{
+	assert(m_meshes.empty());
+	m_launch_class = launch_class;
+	reserve(count);
+	scene::reserveMeshes(static_cast<int>(count), static_cast<int>(count * params::ship::AIRCRAFT_CAPACITY));
+	for (std::size_t i = 0; i < count; ++i) {
+		add(get_spread_position(i, count), 0.f);
+	}
+
+	m_assignment.init(goal_count, count * params::ship::AIRCRAFT_CAPACITY);
+	for (std::size_t i = 0; i < goal_count; ++i) {
+		m_assignment.place_goal(i, get_spread_position(i, goal_count));
+	}
+}
+
+void CarrierPool::deinit()
+{
+	for_each_fleet([](auto & fleet) { fleet.clear(); });
+	for (scene::Mesh * mesh : m_meshes) {
+		scene::destroyMesh(mesh);
+	}
+	m_meshes.clear();
+	m_position_x.clear();
+	m_position_y.clear();
+	m_angles.clear();
+	m_forward_x.clear();
+	m_forward_y.clear();
+	m_inputs.clear();
+	m_aircraft_counts.clear();
+	m_refill_counts.clear();
+	m_next_classes.clear();
+	m_timers.clear();
+	m_states.clear();
+	m_landed.clear();
+	m_assignment.clear();
+}
+
+void CarrierPool::add(const Vector2 & position, float angle)
+{
+	m_meshes.push_back(scene::createShipMesh());
+	m_position_x.push_back(position.x);
+	m_position_y.push_back(position.y);
+	m_angles.push_back(angle);
+	m_forward_x.push_back(std::cos(angle));
+	m_forward_y.push_back(std::sin(angle));
+	m_inputs.push_back(0);
+	m_aircraft_counts.push_back(0);
+	m_refill_counts.push_back(0);
+	m_next_classes.push_back(0);
+	m_states.emplace_back();
+	m_landed.push_back(0);
+}
+
+void CarrierPool::update(float dt)
+{
+	move(dt);
+	m_grid.build(m_position_x.data(), m_position_y.data(), size());
+
+	std::fill(m_landed.begin(), m_landed.end(), 0);
+	for_each_fleet([&](auto & fleet) { fleet.update(dt, m_states, m_grid, m_assignment, m_landed); });
+
+	const std::size_t count = size();
+	std::size_t landings = 0;
+	std::size_t aircraft = 0;
+	std::size_t refills = 0;
+	std::int64_t carrier_aircraft[params::ship::AIRCRAFT_CAPACITY + 1] = {};
+	for (std::size_t i = 0; i < count; ++i) {
+		for (std::uint32_t j = 0; j < m_landed[i]; ++j) {
+			m_timers.schedule(params::ship::REFILL_TIME, TIMER_CARRIER_REFILL, static_cast<std::uint32_t>(i));
+		}
+		m_aircraft_counts[i] -= m_landed[i];
+		m_refill_counts[i] += m_landed[i];
+
+		landings += m_landed[i];
+		aircraft += m_aircraft_counts[i];
+		refills += m_refill_counts[i];
+		++carrier_aircraft[std::min<std::size_t>(m_aircraft_counts[i], params::ship::AIRCRAFT_CAPACITY)];
+	}
+
+	s_landing_counter.add(landings);
+	s_carrier_gauge.set(count);
+	s_aircraft_gauge.set(aircraft);
+	s_refill_gauge.set(refills);
+	for (std::size_t aircraft_count = 0; aircraft_count <= params::ship::AIRCRAFT_CAPACITY; ++aircraft_count) {
+		if (carrier_aircraft[aircraft_count] > 0) {
+			s_carrier_aircraft.record(aircraft_count, carrier_aircraft[aircraft_count]);
+		}
+	}
+
+	// The time of this update has passed, events due by now take effect from the next update
+	m_due_timers.clear();
+	m_timers.advance(dt, m_due_timers);
+	handle_timers();
+
+	// Aircrafts, which took off now, get their slots for the next update
+	m_assignment.solve(ASSIGNMENT_EVALUATIONS);
+}
+
+void CarrierPool::save(SnapshotWriter & snapshot) const
+{
+	snapshot.write(m_launch_class);
+	snapshot.write_array(m_position_x);
+	snapshot.write_array(m_position_y);
+	snapshot.write_array(m_angles);
+	snapshot.write_array(m_forward_x);
+	snapshot.write_array(m_forward_y);
+	snapshot.write_array(m_inputs);
+	snapshot.write_array(m_aircraft_counts);
+	snapshot.write_array(m_refill_counts);
+	snapshot.write_array(m_next_classes);
+	m_timers.save(snapshot);
+	m_assignment.save(snapshot);
+	m_fighters.save(snapshot);
+	m_bombers.save(snapshot);
+	m_scouts.save(snapshot);
+}
+
+bool CarrierPool::restore(SnapshotReader & snapshot)
+{
+	deinit();
+
+	snapshot.read(m_launch_class);
+	snapshot.read_array(m_position_x);
+	const std::size_t count = m_position_x.size();
+	snapshot.read_array(m_position_y, count);
+	snapshot.read_array(m_angles, count);
+	snapshot.read_array(m_forward_x, count);
+	snapshot.read_array(m_forward_y, count);
+	snapshot.read_array(m_inputs, count);
+	snapshot.read_array(m_aircraft_counts, count);
+	snapshot.read_array(m_refill_counts, count);
+	snapshot.read_array(m_next_classes, count);
+
+	bool valid = snapshot.is_valid() && count > 0 && m_launch_class <= AIRCRAFT_MIXED;
+	for (std::size_t size : { m_position_y.size(), m_angles.size(), m_forward_x.size(), m_forward_y.size(), m_inputs.size(),
+		m_aircraft_counts.size(), m_refill_counts.size(), m_next_classes.size() }) {
+		valid = valid && size == count;
+	}
+
+	// The rest is restored into the reserved pool, the way init() leaves it
+	if (valid) {
+		reserve(count);
+		scene::reserveMeshes(static_cast<int>(count), static_cast<int>(count * params::ship::AIRCRAFT_CAPACITY));
+		valid = m_timers.restore(snapshot) && m_assignment.restore(snapshot);
+		for_each_fleet([&](auto & fleet) { valid = valid && fleet.restore(snapshot, count, m_assignment, m_timers); });
+		valid = valid && is_consistent();
+	}
+	if (!valid) {
+		deinit();
+		return false;
+	}
+
+	for (std::size_t i = 0; i < count; ++i) {
+		m_meshes.push_back(scene::createShipMesh());
+		scene::placeMesh(m_meshes.back(), m_position_x[i], m_position_y[i], m_angles[i]);
+	}
+	m_states.resize(count);
+	m_landed.resize(count);
+	return true;
+}
+
+bool CarrierPool::is_consistent() const
+{
+	// Aircrafts in flight are the ones in the fleets, refills are the pending refill events.
+	// The carrier meshes aren't created yet, the arrays tell the count
+	const std::size_t count = m_position_x.size();
+	std::vector<std::uint32_t> aircraft_counts(count, 0);
+	std::vector<std::uint32_t> refill_counts(count, 0);
+	std::vector<std::uint32_t> bidder_counts(m_assignment.get_bidder_count(), 0);
+	for_each_fleet([&](const auto & fleet) { fleet.count_references(aircraft_counts, bidder_counts); });
+
+	bool valid = true;
+	m_timers.for_each_event([&](const TimerEvent & event) {
+		if (event.type == TIMER_CARRIER_REFILL && event.target < count) {
+			++refill_counts[event.target];
+		}
+		else if (event.type == TIMER_CARRIER_REFILL) {
+			valid = false;
+		}
+		else if (event.type > TIMER_CARRIER_REFILL || event.group >= AIRCRAFT_CLASS_COUNT) {
+			valid = false;
+		}
+	});
+
+	for (std::size_t i = 0; valid && i < count; ++i) {
+		valid = m_aircraft_counts[i] == aircraft_counts[i] && m_refill_counts[i] == refill_counts[i] &&
+			m_aircraft_counts[i] + m_refill_counts[i] <= params::ship::AIRCRAFT_CAPACITY && m_next_classes[i] < AIRCRAFT_CLASS_COUNT;
+	}
+
+	// Every active bidder belongs to exactly one patrolling aircraft of all fleets
+	for (std::uint32_t bidder = 0; valid && bidder < bidder_counts.size(); ++bidder) {
+		valid = bidder_counts[bidder] == (m_assignment.is_active(bidder) ? 1u : 0u);
+	}
+	return valid;
+}
+
+void CarrierPool::move(float dt)
+{
+	// All turning carriers rotate by the same angle, its cos and sin are computed once per update
+	const float turn = params::ship::ANGULAR_SPEED * dt;
+	const float turn_cos = std::cos(turn);
+	const float turn_sin = std::sin(turn);
+
+	const std::size_t count = size();
+	for (std::size_t i = 0; i < count; ++i) {
+		const std::uint8_t input = m_inputs[i];
+		float linear_speed = 0.f;
+		float angular_speed = 0.f;
+
+		if (input & get_key_bit(game::KEY_FORWARD)) {
+			linear_speed = params::ship::LINEAR_SPEED;
+		}
+		else if (input & get_key_bit(game::KEY_BACKWARD)) {
+			linear_speed = -params::ship::LINEAR_SPEED;
+		}
+
+		if ((input & get_key_bit(game::KEY_LEFT)) && linear_speed != 0.f) {
+			angular_speed = params::ship::ANGULAR_SPEED;
+		}
+		else if ((input & get_key_bit(game::KEY_RIGHT)) && linear_speed != 0.f) {
+			angular_speed = -params::ship::ANGULAR_SPEED;
+		}
+
+		float rotation = angular_speed * dt;
+		float angle = m_angles[i] + rotation;
+		float rotation_cos = angular_speed != 0.f ? turn_cos : 1.f;
+		float rotation_sin = angular_speed > 0.f ? turn_sin : angular_speed < 0.f ? -turn_sin : 0.f;
+
+		// One Newton step for 1 / |forward| keeps the rotated vector unit length, errors don't accumulate
+		Vector2 forward(rotation_cos * m_forward_x[i] - rotation_sin * m_forward_y[i],
+			rotation_sin * m_forward_x[i] + rotation_cos * m_forward_y[i]);
+		forward = (1.5f - 0.5f * (forward.x * forward.x + forward.y * forward.y)) * forward;
+		m_forward_x[i] = forward.x;
+		m_forward_y[i] = forward.y;
+
+		Vector2 velocity = linear_speed * dt * forward;
+		Vector2 position = Vector2(m_position_x[i], m_position_y[i]) + velocity;
+
+		m_angles[i] = angle;
+		m_position_x[i] = position.x;
+		m_position_y[i] = position.y;
+		scene::placeMesh(m_meshes[i], position.x, position.y, angle);
+
+		m_states[i] = CarrierState{ position, angle, forward, Vector2(-forward.y, forward.x), rotation, rotation_cos, rotation_sin, velocity };
+	}
+}
+
+void CarrierPool::handle_timers()
+{
+	for (const TimerEvent & event : m_due_timers) {
+		if (event.type == TIMER_CARRIER_REFILL) {
+			assert(m_refill_counts[event.target] > 0);
+			--m_refill_counts[event.target];
+		}
+		else {
+			visit_fleet(event.group, [&](auto & fleet) { fleet.handle_timer(event, m_assignment); });
+		}
+	}
+}
+
+void CarrierPool::key_pressed(int key)
+{
+	assert(key >= 0 && key < game::KEY_COUNT);
+	for (std::uint8_t & input : m_inputs) {
+		input |= get_key_bit(key);
+	}
+}
+
+void CarrierPool::key_released(int key)
+{
+	assert(key >= 0 && key < game::KEY_COUNT);
+	for (std::uint8_t & input : m_inputs) {
+		input &= static_cast<std::uint8_t>(~get_key_bit(key));
+	}
+}
+
+void CarrierPool::launch()
+{
+	const std::size_t count = size();
+	for (std::size_t i = 0; i < count; ++i) {
+		if (m_aircraft_counts[i] + m_refill_counts[i] >= params::ship::AIRCRAFT_CAPACITY) {
+			continue;
+		}
+
+		std::uint32_t aircraft_class = m_launch_class;
+		if (aircraft_class == AIRCRAFT_MIXED) {
+			aircraft_class = m_next_classes[i];
+			m_next_classes[i] = static_cast<std::uint8_t>((aircraft_class + 1) % AIRCRAFT_CLASS_COUNT);
+		}
+
+		visit_fleet(aircraft_class, [&](auto & fleet) {
+			fleet.launch(static_cast<std::uint32_t>(i), Vector2(m_position_x[i], m_position_y[i]), m_angles[i], m_timers);
+		});
+		++m_aircraft_counts[i];
+	}
+}
@@ -0,0 +1,155 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "../framework/scene.hpp"
+#include "aircraft_fleet.hpp"
+#include "goal_assignment.hpp"
+#include "params.hpp"
+#include "snapshot.hpp"
+#include "spatial_grid.hpp"
+#include "timer_wheel.hpp"
+#include "vector2.hpp"
+
+
+// Aircraft classes in the order of the carrier pool fleets, the value is the timer group of the class fleet
+enum AircraftClass : std::uint32_t
+{
+	AIRCRAFT_FIGHTER,
+	AIRCRAFT_BOMBER,
+	AIRCRAFT_SCOUT,
+	AIRCRAFT_CLASS_COUNT,
+
+	AIRCRAFT_MIXED = AIRCRAFT_CLASS_COUNT,	// every carrier launches the classes in turn
+};
+
+/*
+ * All carriers of the game, stored as parallel arrays, with one shared pool for their aircrafts
+ * Carrier index is the position in the arrays, aircrafts refer to their home carrier by it
+ *
+ * An update is a few linear passes over all carriers: movement, then the whole aircraft fleet at once
+ * against the carrier states gathered by the movement pass
+ * There is a fleet per aircraft class, all of them are updated one after another, carrier capacity is shared
+ * Aircraft phase changes and refills are events of one timer wheel, nothing is polled per frame
+ * Patrolling aircrafts of all fleets share the goals, the assignment is solved a budget of work per update
+ */
+class CarrierPool
+{
+public:
+	explicit CarrierPool(std::size_t reserve);
+	~CarrierPool();
+
+	CarrierPool(const CarrierPool &) = delete;
+	CarrierPool & operator = (const CarrierPool &) = delete;
+
+	std::size_t size() const { return m_meshes.size(); }
+
+	// Makes room for count carriers with all of their aircrafts, init does it for its count
+	void reserve(std::size_t count);
+
+	// Class by its params::aircraft NAME or "mixed", returns false if the name is unknown
+	static bool find_aircraft_class(const char * name, AircraftClass & aircraft_class);
+
+	// Carriers and goals are spread evenly over the visible world area, a single one starts in the center
+	void init(std::size_t count, AircraftClass launch_class = AIRCRAFT_FIGHTER, std::size_t goal_count = 1);
+	void deinit();
+
+	std::size_t get_goal_count() const { return m_assignment.get_goal_count(); }
+	const Vector2 & get_goal(std::size_t goal) const { return m_assignment.get_goal(goal); }
+	void place_goal(std::size_t goal, const Vector2 & position) { m_assignment.place_goal(goal, position); }
+
+	void update(float dt);
+
+	// The whole simulation state: carriers, their aircrafts, pending timers and the goal assignment
+	// Restore replaces the current state, a rejected snapshot leaves the pool deinitialized. Every part checks
+	// its own indices, the pool checks the aircraft and refill counts of the carriers against the fleets and timers
+	void save(SnapshotWriter & snapshot) const;
+	bool restore(SnapshotReader & snapshot);
+
+	// Keyboard input is given to every carrier, launch is done by every carrier, which has a free aircraft
+	void key_pressed(int key);
+	void key_released(int key);
+	void launch();
+
+private:
+	// Calls function(fleet) for every class fleet, in the AircraftClass order
+	template <class Function>
+	void for_each_fleet(Function && function);
+	template <class Function>
+	void for_each_fleet(Function && function) const;
+
+	// Calls function(fleet) for the fleet of the given class only
+	template <class Function>
+	void visit_fleet(std::uint32_t aircraft_class, Function && function);
+
+	void add(const Vector2 & position, float angle);
+	void move(float dt);
+	void handle_timers();
+	bool is_consistent() const;
+
+	std::vector<scene::Mesh*> m_meshes;
+	std::vector<float> m_position_x;
+	std::vector<float> m_position_y;
+	std::vector<float> m_angles;
+	std::vector<float> m_forward_x;	// unit vector of the angle, rotated incrementally by move()
+	std::vector<float> m_forward_y;
+	std::vector<std::uint8_t> m_inputs;	// bit per game key
+
+	// Aircrafts in flight and being refilled per carrier
+	std::vector<std::uint32_t> m_aircraft_counts;
+	std::vector<std::uint32_t> m_refill_counts;
+	std::vector<std::uint8_t> m_next_classes;	// class of the next launch in the AIRCRAFT_MIXED mode
+
+	TimerWheel m_timers;
+	std::vector<TimerEvent> m_due_timers;
+
+	// Gathered by move() for the aircraft update
+	std::vector<CarrierState> m_states;
+	std::vector<std::uint32_t> m_landed;
+	SpatialGrid m_grid;
+
+	GoalAssignment m_assignment;
+
+	AircraftClass m_launch_class = AIRCRAFT_FIGHTER;
+	AircraftFleet<params::aircraft::Fighter> m_fighters;
+	AircraftFleet<params::aircraft::Bomber> m_bombers;
+	AircraftFleet<params::aircraft::Scout> m_scouts;
+};
+
+template <class Function>
+void CarrierPool::for_each_fleet(Function && function)
+{
+	function(m_fighters);
+	function(m_bombers);
+	function(m_scouts);
+}
+
+template <class Function>
+void CarrierPool::for_each_fleet(Function && function) const
+{
+	function(m_fighters);
+	function(m_bombers);
+	function(m_scouts);
+}
+
+template <class Function>
+void CarrierPool::visit_fleet(std::uint32_t aircraft_class, Function && function)
+{
+	switch (aircraft_class) {
+	case AIRCRAFT_FIGHTER:
+		function(m_fighters);
+		break;
+	case AIRCRAFT_BOMBER:
+		function(m_bombers);
+		break;
+	case AIRCRAFT_SCOUT:
+		function(m_scouts);
+		break;
+	default:
+		assert(!"unknown aircraft class");
+		break;
+	}
+}
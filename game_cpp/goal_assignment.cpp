@@ -0,0 +1,372 @@
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "goal_assignment.hpp"
+
+
+constexpr std::uint32_t GoalAssignment::NONE;
+
+void GoalAssignment::init(std::size_t goal_count, std::size_t aircraft_capacity)
+{
+	assert(goal_count > 0);
+	m_goals.assign(goal_count, Vector2());
+	m_slots_per_goal = std::max<std::size_t>((aircraft_capacity + goal_count - 1) / goal_count, 1);
+	m_heap_depth = 0;
+	while ((std::size_t(1) << m_heap_depth) <= m_slots_per_goal) {
+		++m_heap_depth;
+	}
+	m_prices.resize(goal_count * m_slots_per_goal);
+	m_owners.resize(goal_count * m_slots_per_goal);
+	m_heap.resize(goal_count * m_slots_per_goal);
+	m_heap_positions.resize(goal_count * m_slots_per_goal);
+	m_bidders.reserve(aircraft_capacity);
+	m_waiting.reserve(aircraft_capacity);
+	clear();
+}
+
+void GoalAssignment::clear()
+{
+	m_bidders.clear();
+	m_free = NONE;
+	m_active_count = 0;
+	m_waiting.clear();
+	restart();
+}
+
+void GoalAssignment::place_goal(std::size_t goal, const Vector2 & position)
+{
+	m_goals[goal] = position;
+	m_restart = true;
+}
+
+void GoalAssignment::restart()
+{
+	std::fill(m_prices.begin(), m_prices.end(), 0.f);
+	std::fill(m_owners.begin(), m_owners.end(), NONE);
+	// Equal prices, any order is a heap
+	for (std::uint32_t slot = 0; slot < m_heap.size(); ++slot) {
+		m_heap[slot] = slot;
+		m_heap_positions[slot] = slot;
+	}
+
+	// Aircrafts keep their goals until they win new slots
+	for (std::uint32_t bidder = 0; bidder < m_bidders.size(); ++bidder) {
+		if (m_bidders[bidder].active) {
+			m_bidders[bidder].slot = NONE;
+			wait(bidder);
+		}
+	}
+	m_restart = false;
+}
+
+void GoalAssignment::wait(std::uint32_t bidder)
+{
+	if (!m_bidders[bidder].waiting) {
+		m_bidders[bidder].waiting = true;
+		m_waiting.push_back(bidder);
+	}
+}
+
+std::uint32_t GoalAssignment::add(const Vector2 & position)
+{
+	std::uint32_t bidder = m_free;
+	if (bidder != NONE) {
+		m_free = m_bidders[bidder].next;
+	}
+	else {
+		bidder = static_cast<std::uint32_t>(m_bidders.size());
+		m_bidders.push_back(Bidder{ Vector2(), NONE, 0, NONE, 0, 0 });
+	}
+
+	// A removed bidder can still be in the waiting list, its waiting flag is kept to not add it twice
+	Bidder & added = m_bidders[bidder];
+	added.position = position;
+	added.slot = NONE;
+	added.goal = find_nearest(position);
+	added.active = true;
+	++m_active_count;
+	assert(m_active_count <= m_owners.size() && "more aircrafts than goal slots");
+	wait(bidder);
+	return bidder;
+}
+
+void GoalAssignment::remove(std::uint32_t bidder)
+{
+	// The freed slot drops to the cheapest price of its goal: the goal already offered that value to everyone,
+	// so no aircraft gets a better choice, and the next bidder takes the free slot instead of outbidding
+	Bidder & removed = m_bidders[bidder];
+	assert(removed.active);
+	if (removed.slot != NONE) {
+		m_owners[removed.slot] = NONE;
+		m_prices[removed.slot] = m_prices[get_cheapest(removed.goal)];
+		sift_up(removed.slot);
+	}
+	removed.slot = NONE;
+	removed.active = false;
+	removed.next = m_free;
+	m_free = bidder;
+	--m_active_count;
+}
+
+std::size_t GoalAssignment::solve(std::size_t max_evaluations)
+{
+	if (m_restart) {
+		restart();
+	}
+
+	const std::size_t bid_evaluations = m_goals.size() + m_heap_depth;
+	std::size_t evaluations = 0;
+	while (!m_waiting.empty() && (evaluations == 0 || evaluations + bid_evaluations <= max_evaluations)) {
+		const std::uint32_t bidder = m_waiting.back();
+		m_waiting.pop_back();
+		m_bidders[bidder].waiting = false;
+		if (m_bidders[bidder].active && m_bidders[bidder].slot == NONE) {
+			bid(bidder);
+			evaluations += bid_evaluations;
+		}
+	}
+	return evaluations;
+}
+
+void GoalAssignment::bid(std::uint32_t bidder)
+{
+	const Vector2 position = m_bidders[bidder].position;
+	const float lowest = -std::numeric_limits<float>::infinity();
+
+	// The best and the second best values over the cheapest slots of all goals
+	float best = lowest;
+	float second = lowest;
+	float best_distance = 0.f;
+	std::uint32_t best_goal = 0;
+	for (std::uint32_t goal = 0; goal < m_goals.size(); ++goal) {
+		const float dx = m_goals[goal].x - position.x;
+		const float dy = m_goals[goal].y - position.y;
+		const float distance = std::sqrt(dx * dx + dy * dy);
+		const float value = -distance - m_prices[get_cheapest(goal)];
+		if (value > best) {
+			second = best;
+			best = value;
+			best_distance = distance;
+			best_goal = goal;
+		}
+		else if (value > second) {
+			second = value;
+		}
+	}
+
+	// The next cheapest slot of the best goal competes too, it is a child of the heap root
+	const std::uint32_t slot = get_cheapest(best_goal);
+	const std::size_t root = best_goal * m_slots_per_goal;
+	for (std::size_t child = 1; child <= 2 && child < m_slots_per_goal; ++child) {
+		second = std::max(second, -best_distance - m_prices[m_heap[root + child]]);
+	}
+
+	m_prices[slot] += (second > lowest ? best - second : 0.f) + EPSILON;
+	const std::uint32_t outbid = m_owners[slot];
+	if (outbid != NONE) {
+		m_bidders[outbid].slot = NONE;
+		wait(outbid);
+	}
+	m_owners[slot] = bidder;
+	m_bidders[bidder].slot = slot;
+	m_bidders[bidder].goal = best_goal;
+	sift_down(slot);
+}
+
+bool GoalAssignment::is_cheaper(std::uint32_t lhv, std::uint32_t rhv) const
+{
+	if (m_prices[lhv] != m_prices[rhv]) {
+		return m_prices[lhv] < m_prices[rhv];
+	}
+	return m_owners[lhv] == NONE && m_owners[rhv] != NONE;
+}
+
+void GoalAssignment::sift_up(std::uint32_t slot)
+{
+	// Heap positions are relative to the goal range, so the usual index arithmetic works
+	const std::size_t root = slot / m_slots_per_goal * m_slots_per_goal;
+	std::size_t position = m_heap_positions[slot] - root;
+	while (position > 0) {
+		const std::size_t parent = (position - 1) / 2;
+		const std::uint32_t parent_slot = m_heap[root + parent];
+		if (!is_cheaper(slot, parent_slot)) {
+			break;
+		}
+		m_heap[root + position] = parent_slot;
+		m_heap_positions[parent_slot] = static_cast<std::uint32_t>(root + position);
+		position = parent;
+	}
+	m_heap[root + position] = slot;
+	m_heap_positions[slot] = static_cast<std::uint32_t>(root + position);
+}
+
+void GoalAssignment::sift_down(std::uint32_t slot)
+{
+	const std::size_t root = slot / m_slots_per_goal * m_slots_per_goal;
+	std::size_t position = m_heap_positions[slot] - root;
+	for (;;) {
+		std::size_t child = 2 * position + 1;
+		if (child >= m_slots_per_goal) {
+			break;
+		}
+		if (child + 1 < m_slots_per_goal && is_cheaper(m_heap[root + child + 1], m_heap[root + child])) {
+			++child;
+		}
+		const std::uint32_t child_slot = m_heap[root + child];
+		if (!is_cheaper(child_slot, slot)) {
+			break;
+		}
+		m_heap[root + position] = child_slot;
+		m_heap_positions[child_slot] = static_cast<std::uint32_t>(root + position);
+		position = child;
+	}
+	m_heap[root + position] = slot;
+	m_heap_positions[slot] = static_cast<std::uint32_t>(root + position);
+}
+
+std::uint32_t GoalAssignment::find_nearest(const Vector2 & position) const
+{
+	std::uint32_t nearest = 0;
+	float nearest_distance_squared = std::numeric_limits<float>::infinity();
+	for (std::uint32_t goal = 0; goal < m_goals.size(); ++goal) {
+		const float dx = m_goals[goal].x - position.x;
+		const float dy = m_goals[goal].y - position.y;
+		const float distance_squared = dx * dx + dy * dy;
+		if (distance_squared < nearest_distance_squared) {
+			nearest_distance_squared = distance_squared;
+			nearest = goal;
+		}
+	}
+	return nearest;
+}
+
+void GoalAssignment::save(SnapshotWriter & snapshot) const
+{
+	snapshot.write_array(m_goals);
+	snapshot.write(static_cast<std::uint64_t>(m_slots_per_goal));
+	snapshot.write(static_cast<std::uint64_t>(m_heap_depth));
+	snapshot.write_array(m_prices);
+	snapshot.write_array(m_owners);
+	snapshot.write_array(m_heap);
+	snapshot.write_array(m_heap_positions);
+	snapshot.write_array(m_bidders);
+	snapshot.write(m_free);
+	snapshot.write(static_cast<std::uint64_t>(m_active_count));
+	snapshot.write_array(m_waiting);
+	snapshot.write(static_cast<std::uint8_t>(m_restart));
+}
+
+bool GoalAssignment::restore(SnapshotReader & snapshot)
+{
+	std::uint64_t slots_per_goal = 0;
+	std::uint64_t heap_depth = 0;
+	std::uint64_t active_count = 0;
+	std::uint8_t restart = 0;
+	snapshot.read_array(m_goals);
+	snapshot.read(slots_per_goal);
+	snapshot.read(heap_depth);
+	snapshot.read_array(m_prices);
+	snapshot.read_array(m_owners);
+	snapshot.read_array(m_heap);
+	snapshot.read_array(m_heap_positions);
+
+	// Every aircraft has a slot, so the slot count bounds both lists
+	snapshot.read_array(m_bidders, m_owners.size());
+	snapshot.read(m_free);
+	snapshot.read(active_count);
+	snapshot.read_array(m_waiting, m_owners.size());
+	snapshot.read(restart);
+
+	// The slot count is checked without multiplying, a broken slots per goal can't wrap it around
+	const std::size_t slot_count = m_owners.size();
+	bool valid = snapshot.is_valid() && !m_goals.empty() && slots_per_goal > 0 && slot_count % m_goals.size() == 0 &&
+		slot_count / m_goals.size() == slots_per_goal && m_prices.size() == slot_count &&
+		m_heap.size() == slot_count && m_heap_positions.size() == slot_count && restart <= 1;
+	if (valid) {
+		m_slots_per_goal = static_cast<std::size_t>(slots_per_goal);
+		m_heap_depth = static_cast<std::size_t>(heap_depth);
+		m_active_count = static_cast<std::size_t>(active_count);
+		m_restart = restart != 0;
+		valid = is_consistent();
+	}
+	if (!valid) {
+		init(1, 0);
+		return false;
+	}
+
+	// Aircrafts join during updates, the lists have to hold all of them without allocating
+	m_bidders.reserve(slot_count);
+	m_waiting.reserve(slot_count);
+	return true;
+}
+
+bool GoalAssignment::is_consistent() const
+{
+	const std::size_t slot_count = m_owners.size();
+	const std::size_t bidder_count = m_bidders.size();
+	if (m_heap_depth == 0 || m_heap_depth >= 64 || (std::size_t(1) << (m_heap_depth - 1)) > m_slots_per_goal ||
+		(std::size_t(1) << m_heap_depth) <= m_slots_per_goal) {
+		return false;
+	}
+
+	// The heap of every goal holds each slot of the goal once, in order: heap and positions are inverse
+	for (std::size_t position = 0; position < slot_count; ++position) {
+		const std::size_t root = position / m_slots_per_goal * m_slots_per_goal;
+		const std::uint32_t slot = m_heap[position];
+		if (slot < root || slot >= root + m_slots_per_goal || m_heap_positions[slot] != position || !std::isfinite(m_prices[slot])) {
+			return false;
+		}
+		if (position > root && is_cheaper(slot, m_heap[root + (position - root - 1) / 2])) {
+			return false;
+		}
+	}
+
+	// Slots and their owners refer to each other
+	for (std::size_t slot = 0; slot < slot_count; ++slot) {
+		const std::uint32_t owner = m_owners[slot];
+		if (owner != NONE && (owner >= bidder_count || !m_bidders[owner].active || m_bidders[owner].slot != slot)) {
+			return false;
+		}
+	}
+
+	// An active aircraft without a slot waits for one, unless the whole auction restarts anyway
+	std::size_t active_count = 0;
+	std::size_t waiting_count = 0;
+	for (std::uint32_t bidder = 0; bidder < bidder_count; ++bidder) {
+		const Bidder & checked = m_bidders[bidder];
+		if (checked.goal >= m_goals.size() || checked.active > 1 || checked.waiting > 1) {
+			return false;
+		}
+		if (checked.slot != NONE && (!checked.active || checked.slot >= slot_count || m_owners[checked.slot] != bidder ||
+			checked.slot / m_slots_per_goal != checked.goal)) {
+			return false;
+		}
+		if (checked.active && checked.slot == NONE && !checked.waiting && !m_restart) {
+			return false;
+		}
+		active_count += checked.active ? 1 : 0;
+		waiting_count += checked.waiting ? 1 : 0;
+	}
+	if (active_count != m_active_count || m_waiting.size() != waiting_count) {
+		return false;
+	}
+
+	// The waiting list holds exactly the waiting bidders, the free list exactly the inactive ones
+	std::vector<bool> listed(bidder_count, false);
+	for (std::uint32_t bidder : m_waiting) {
+		if (bidder >= bidder_count || !m_bidders[bidder].waiting || listed[bidder]) {
+			return false;
+		}
+		listed[bidder] = true;
+	}
+
+	std::size_t free_count = 0;
+	for (std::uint32_t bidder = m_free; bidder != NONE; bidder = m_bidders[bidder].next) {
+		if (bidder >= bidder_count || m_bidders[bidder].active || ++free_count > bidder_count - active_count) {
+			return false;
+		}
+	}
+	return free_count + active_count == bidder_count;
+}
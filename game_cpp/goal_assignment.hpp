@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snapshot.hpp"
+#include "vector2.hpp"
+
+
+/*
+ * Assignment of patrolling aircrafts to goals by the auction algorithm
+ *
+ * Every goal has the same number of slots, together enough for all aircrafts the carriers can launch, so
+ * aircrafts are spread evenly when they are many. Aircrafts bid for slots: the value of a slot is minus the
+ * distance to its goal minus the slot price. An unassigned aircraft takes the slot of the best value and raises
+ * its price by the difference to the second best value plus EPSILON, the outbid holder bids again later
+ * Slots of a goal are equal for everyone but the price, every goal keeps them in a min heap by price,
+ * so a bid evaluates every goal once and the two cheapest slots of the best one
+ * When every aircraft holds a slot, its value is within EPSILON from the best one, so the total distance
+ * is within EPSILON per aircraft from the optimal assignment
+ *
+ * The solver is incremental: prices stay between solve calls, a new aircraft only bids for itself and
+ * the ones it outbids, a removed one frees its slot. Moving a goal changes the values of all aircrafts
+ * and restarts the auction. solve() is limited by the number of evaluated goals, the bids left over
+ * continue on the next call and an aircraft waiting for a slot keeps its previous goal meanwhile
+ */
+class GoalAssignment
+{
+public:
+	// Slot price step, in world units of distance: far below the orbit radii, and the number of bids
+	// of a full auction is about inversely proportional to it
+	static constexpr float EPSILON = 0.1f;
+
+	// Drops all aircrafts, the goals are placed at the origin
+	void init(std::size_t goal_count, std::size_t aircraft_capacity);
+	void clear();
+
+	std::size_t get_goal_count() const { return m_goals.size(); }
+	const Vector2 & get_goal(std::size_t goal) const { return m_goals[goal]; }
+	void place_goal(std::size_t goal, const Vector2 & position);
+
+	// Aircrafts are referred to by bidder handles, the position is the one the aircraft bids from.
+	// An added aircraft orbits the nearest goal until it wins a slot
+	std::uint32_t add(const Vector2 & position);
+	void remove(std::uint32_t bidder);
+	void set_position(std::uint32_t bidder, const Vector2 & position) { m_bidders[bidder].position = position; }
+	std::uint32_t get_goal_of(std::uint32_t bidder) const { return m_bidders[bidder].goal; }
+
+	// Handles of the added aircrafts are below the bidder count, the removed ones aren't active
+	std::size_t get_bidder_count() const { return m_bidders.size(); }
+	bool is_active(std::uint32_t bidder) const { return bidder < m_bidders.size() && m_bidders[bidder].active; }
+
+	// Runs bids until no aircraft waits or about max_evaluations goal values were evaluated, at least one bid.
+	// Returns the number of evaluations
+	std::size_t solve(std::size_t max_evaluations);
+	bool is_solved() const { return m_waiting.empty() && !m_restart; }
+
+	// Goals, prices and bidders as is, a restored auction continues where it was saved. A snapshot, which
+	// refers out of its slots or bidders or breaks a heap, is rejected, the assignment is left with no bidders then
+	void save(SnapshotWriter & snapshot) const;
+	bool restore(SnapshotReader & snapshot);
+
+private:
+	static constexpr std::uint32_t NONE = ~std::uint32_t(0);
+
+	struct Bidder
+	{
+		Vector2 position;
+		std::uint32_t slot;		// NONE while waiting
+		std::uint32_t goal;		// of the slot, or the previous one while waiting
+		std::uint32_t next;		// next free handle for a free bidder
+		// Flags as bytes, so a restored bidder with any other value than 0 or 1 is an error and not undefined
+		std::uint8_t active;
+		std::uint8_t waiting;
+	};
+
+	void restart();
+	void wait(std::uint32_t bidder);
+	void bid(std::uint32_t bidder);
+
+	// Heap of the goal slots, the cheapest first, a free slot goes before an owned one of the same price
+	bool is_cheaper(std::uint32_t lhv, std::uint32_t rhv) const;
+	void sift_up(std::uint32_t slot);
+	void sift_down(std::uint32_t slot);
+	std::uint32_t get_cheapest(std::uint32_t goal) const { return m_heap[goal * m_slots_per_goal]; }
+	std::uint32_t find_nearest(const Vector2 & position) const;
+	bool is_consistent() const;
+
+	std::vector<Vector2> m_goals;
+	std::size_t m_slots_per_goal = 0;
+	std::size_t m_heap_depth = 0;
+
+	// Slot s belongs to the goal s / m_slots_per_goal
+	std::vector<float> m_prices;
+	std::vector<std::uint32_t> m_owners;
+	std::vector<std::uint32_t> m_heap;	// heap of the goal slots in the slot range of the goal
+	std::vector<std::uint32_t> m_heap_positions;	// per slot, its index in m_heap
+
+	std::vector<Bidder> m_bidders;
+	std::uint32_t m_free = NONE;
+	std::size_t m_active_count = 0;
+	std::vector<std::uint32_t> m_waiting;
+	bool m_restart = false;
+};
@@ -3,8 +3,8 @@
 #include "../framework/engine.hpp"
 
 
-int main()
+int main( int argc, char **argv )
 {
-	engine::run();
+	engine::run( argc, argv );
 	return 0;
 }
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+
+
+//-------------------------------------------------------
+//	game parameters
+//-------------------------------------------------------
+
+namespace params
+{
+	namespace ship
+	{
+		constexpr float LINEAR_SPEED = 0.5f;
+		constexpr float ANGULAR_SPEED = 0.5f;
+
+		// Actually, this value should be calculated via "collider" size or mesh size, but framework doesn't provide this info
+		constexpr float SIZE = 0.2f;
+
+		constexpr float REFILL_TIME = 10.f;
+
+		// Aircrafts in flight plus the ones being refilled
+		constexpr std::size_t AIRCRAFT_CAPACITY = 5;
+	}
+
+	/*
+	 * Aircraft classes, every class is a traits struct and AircraftFleet is specialized for each of them,
+	 * so the update loops of a class fold its constants and all derived values at compile time
+	 */
+	namespace aircraft
+	{
+		// Every flying aircraft leaves a trail particle this often, scene::reserveMeshes sizes the trails for it
+		constexpr float TRAIL_INTERVAL = 0.1f;
+
+		// Default class: the all-round aircraft
+		struct Fighter
+		{
+			static constexpr const char * NAME = "fighter";
+
+			static constexpr float TARGET_RADIUS = 1.5f;
+
+			static constexpr float LINEAR_ACCELERATION = 0.3f;
+			static constexpr float LINEAR_SPEED = 2.5f;
+
+			static constexpr float ANGULAR_SPEED = 2.5f;
+
+			static constexpr float TAKEOFF_TIME = 3.f;
+			static constexpr float LIVE_TIME = 50.f;
+
+			static constexpr float LANDING_SPEED = LINEAR_SPEED / 1.5f;
+		};
+
+		// Slow and sluggish, patrols a wider orbit and stays in the air longer
+		struct Bomber
+		{
+			static constexpr const char * NAME = "bomber";
+
+			static constexpr float TARGET_RADIUS = 2.f;
+
+			static constexpr float LINEAR_ACCELERATION = 0.15f;
+			static constexpr float LINEAR_SPEED = 1.6f;
+
+			static constexpr float ANGULAR_SPEED = 1.2f;
+
+			static constexpr float TAKEOFF_TIME = 4.f;
+			static constexpr float LIVE_TIME = 80.f;
+
+			static constexpr float LANDING_SPEED = LINEAR_SPEED / 1.4f;
+		};
+
+		// Fast and agile, but with a short flight time
+		struct Scout
+		{
+			static constexpr const char * NAME = "scout";
+
+			static constexpr float TARGET_RADIUS = 2.5f;
+
+			static constexpr float LINEAR_ACCELERATION = 0.5f;
+			static constexpr float LINEAR_SPEED = 3.5f;
+
+			static constexpr float ANGULAR_SPEED = 3.5f;
+
+			static constexpr float TAKEOFF_TIME = 2.f;
+			static constexpr float LIVE_TIME = 30.f;
+
+			static constexpr float LANDING_SPEED = LINEAR_SPEED / 1.6f;
+		};
+	}
+}
@@ -0,0 +1,72 @@
+#include "snapshot.hpp"
+
+
+constexpr std::uint32_t SnapshotWriter::MAGIC;
+constexpr std::uint32_t SnapshotWriter::VERSION;
+constexpr std::size_t SnapshotWriter::ALIGNMENT;
+
+namespace
+{
+	// Offset of the total size in the header
+	constexpr std::size_t SIZE_OFFSET = 2 * sizeof(std::uint32_t);
+	constexpr std::size_t HEADER_SIZE = SIZE_OFFSET + sizeof(std::uint64_t);
+}
+
+SnapshotWriter::SnapshotWriter()
+{
+	write(MAGIC);
+	write(VERSION);
+	write(std::uint64_t(0));
+}
+
+void SnapshotWriter::append(const void * data, std::size_t size)
+{
+	const char * bytes = static_cast<const char *>(data);
+	m_data.insert(m_data.end(), bytes, bytes + size);
+}
+
+void SnapshotWriter::align()
+{
+	m_data.resize((m_data.size() + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT, 0);
+}
+
+const std::vector<char> & SnapshotWriter::get_data()
+{
+	const std::uint64_t size = m_data.size();
+	std::memcpy(m_data.data() + SIZE_OFFSET, &size, sizeof(size));
+	return m_data;
+}
+
+SnapshotReader::SnapshotReader(const void * data, std::size_t size) :
+	m_data(static_cast<const char *>(data)),
+	m_size(size)
+{
+	std::uint64_t snapshot_size = 0;
+	expect(SnapshotWriter::MAGIC);
+	expect(SnapshotWriter::VERSION);
+	if (read(snapshot_size) && snapshot_size != size) {
+		m_valid = false;
+	}
+}
+
+const void * SnapshotReader::consume(std::size_t size)
+{
+	if (!m_valid || size > m_size - m_offset) {
+		m_valid = false;
+		return nullptr;
+	}
+
+	const void * data = m_data + m_offset;
+	m_offset += size;
+	return data;
+}
+
+void SnapshotReader::align()
+{
+	const std::size_t aligned = (m_offset + SnapshotWriter::ALIGNMENT - 1) / SnapshotWriter::ALIGNMENT * SnapshotWriter::ALIGNMENT;
+	if (aligned > m_size) {
+		m_valid = false;
+		return;
+	}
+	m_offset = aligned;
+}
@@ -0,0 +1,136 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+
+/*
+ * Flat binary snapshot of the simulation state
+ *
+ * Layout, host byte order: header { uint32 magic "WSNP", uint32 version, uint64 size of the whole snapshot }
+ * followed by the fields in the order they were written. A value is stored as is, an array as its uint64
+ * element count followed by the elements, which start at a multiple of ALIGNMENT from the beginning:
+ * a snapshot read or mapped to an aligned address holds every array ready to be used in place
+ *
+ * Every state owner writes and reads its own part in the same order, there are no field names or tags.
+ * Any change to what is written needs a new VERSION, snapshots of other versions are rejected
+ * Reading copies every array with one memcpy into its vector. A reader, which ran past the end or met
+ * a mismatch, fails all further reads, so owners check the result once at the end
+ */
+class SnapshotWriter
+{
+public:
+	static constexpr std::uint32_t MAGIC = 0x504e5357;	// "WSNP"
+	static constexpr std::uint32_t VERSION = 2;
+	static constexpr std::size_t ALIGNMENT = 16;
+
+	SnapshotWriter();
+
+	template <class T>
+	void write(const T & value);
+
+	template <class T>
+	void write_array(const std::vector<T> & values);
+
+	// The complete snapshot, with the size in the header filled in
+	const std::vector<char> & get_data();
+
+private:
+	void append(const void * data, std::size_t size);
+	void align();
+
+	std::vector<char> m_data;
+};
+
+class SnapshotReader
+{
+public:
+	// The data has to stay alive while reading, it isn't copied
+	SnapshotReader(const void * data, std::size_t size);
+
+	bool is_valid() const { return m_valid; }
+
+	template <class T>
+	bool read(T & value);
+
+	// Fails arrays longer than max_count, so a broken snapshot can't make the owner allocate without bound
+	template <class T>
+	bool read_array(std::vector<T> & values, std::size_t max_count = ~std::size_t(0));
+
+	// Reads a value and fails unless it is the expected one, for sizes and parameters the owner can't change
+	template <class T>
+	bool expect(const T & expected);
+
+private:
+	const void * consume(std::size_t size);
+	void align();
+
+	const char * m_data;
+	std::size_t m_size;
+	std::size_t m_offset = 0;
+	bool m_valid = true;
+};
+
+template <class T>
+void SnapshotWriter::write(const T & value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "snapshot values are copied as bytes");
+	append(&value, sizeof(value));
+}
+
+template <class T>
+void SnapshotWriter::write_array(const std::vector<T> & values)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays are copied as bytes");
+	write(static_cast<std::uint64_t>(values.size()));
+	align();
+	append(values.data(), values.size() * sizeof(T));
+}
+
+template <class T>
+bool SnapshotReader::read(T & value)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "snapshot values are copied as bytes");
+	const void * data = consume(sizeof(value));
+	if (data) {
+		std::memcpy(&value, data, sizeof(value));
+	}
+	return m_valid;
+}
+
+template <class T>
+bool SnapshotReader::read_array(std::vector<T> & values, std::size_t max_count)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "snapshot arrays are copied as bytes");
+	std::uint64_t count = 0;
+	if (!read(count) || count > max_count || count > m_size / sizeof(T)) {
+		m_valid = false;
+		return false;
+	}
+
+	align();
+	const void * data = consume(static_cast<std::size_t>(count) * sizeof(T));
+	if (!data) {
+		return false;
+	}
+
+	// Vectors reserved beforehand keep their capacity
+	values.resize(static_cast<std::size_t>(count));
+	if (count > 0) {
+		std::memcpy(values.data(), data, static_cast<std::size_t>(count) * sizeof(T));
+	}
+	return true;
+}
+
+template <class T>
+bool SnapshotReader::expect(const T & expected)
+{
+	T value{};
+	if (read(value) && std::memcmp(&value, &expected, sizeof(T)) != 0) {
+		m_valid = false;
+	}
+	return m_valid;
+}
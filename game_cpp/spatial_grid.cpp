@@ -0,0 +1,191 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+
+#include "../framework/memory.hpp"
+#include "../framework/scene.hpp"
+#include "spatial_grid.hpp"
+
+
+SpatialGrid::SpatialGrid(const Vector2 & min, const Vector2 & max, float cell_size, bool can_grow) :
+	m_initial_min(min),
+	m_initial_max(max),
+	m_min(min),
+	m_cell_size(cell_size),
+	m_inverse_cell_size(1.f / cell_size),
+	m_can_grow(can_grow)
+{
+	assert(cell_size > 0.f && max.x > min.x && max.y > min.y);
+	if (can_grow) {
+		m_cell_starts.reserve(MAX_CELLS + 1);
+	}
+	resize(min, max);
+}
+
+void SpatialGrid::reserve(std::size_t count)
+{
+	m_items.reserve(count);
+	m_overflow.reserve(count);
+}
+
+void SpatialGrid::resize(const Vector2 & min, const Vector2 & max)
+{
+	m_min = min;
+	m_columns = std::max(1, static_cast<int>(std::ceil((max.x - min.x) * m_inverse_cell_size)));
+	m_rows = std::max(1, static_cast<int>(std::ceil((max.y - min.y) * m_inverse_cell_size)));
+	m_cell_starts.assign(static_cast<std::size_t>(m_columns) * m_rows + 1, 0);
+}
+
+int SpatialGrid::get_column(float x) const
+{
+	return static_cast<int>(std::floor((x - m_min.x) * m_inverse_cell_size));
+}
+
+int SpatialGrid::get_row(float y) const
+{
+	return static_cast<int>(std::floor((y - m_min.y) * m_inverse_cell_size));
+}
+
+void SpatialGrid::build(const float * x, const float * y, std::size_t count)
+{
+	if (m_can_grow) {
+		// Always start from the initial bounds, so the grid shrinks back once the points return
+		Vector2 min = m_initial_min;
+		Vector2 max = m_initial_max;
+		for (std::size_t i = 0; i < count; ++i) {
+			min = Vector2(std::min(min.x, x[i]), std::min(min.y, y[i]));
+			max = Vector2(std::max(max.x, x[i]), std::max(max.y, y[i]));
+		}
+
+		// Grow by whole cells to keep the cell positions stable
+		float left = std::ceil((m_initial_min.x - min.x) * m_inverse_cell_size);
+		float bottom = std::ceil((m_initial_min.y - min.y) * m_inverse_cell_size);
+		float right = max.x > m_initial_max.x ? std::floor((max.x - m_initial_max.x) * m_inverse_cell_size) + 1.f : 0.f;
+		float top = max.y > m_initial_max.y ? std::floor((max.y - m_initial_max.y) * m_inverse_cell_size) + 1.f : 0.f;
+		min = Vector2(m_initial_min.x - left * m_cell_size, m_initial_min.y - bottom * m_cell_size);
+		max = Vector2(m_initial_max.x + right * m_cell_size, m_initial_max.y + top * m_cell_size);
+
+		double cells = std::ceil((max.x - min.x) * m_inverse_cell_size) * std::ceil((max.y - min.y) * m_inverse_cell_size);
+		if (cells > MAX_CELLS) {
+			min = m_initial_min;
+			max = m_initial_max;
+		}
+		if (min.x != m_min.x || min.y != m_min.y ||
+			std::ceil((max.x - min.x) * m_inverse_cell_size) != m_columns ||
+			std::ceil((max.y - min.y) * m_inverse_cell_size) != m_rows) {
+			resize(min, max);
+		}
+	}
+
+	const std::size_t cell_count = static_cast<std::size_t>(m_columns) * m_rows;
+	std::fill(m_cell_starts.begin(), m_cell_starts.end(), 0);
+	// Cell of every point or -1 for the overflow
+	int * point_cells = memory::allocateFrameArray<int>(count);
+	m_overflow.clear();
+
+	// Count points per cell, shifted by one so the prefix sum gives the cell starts directly
+	std::size_t grid_count = 0;
+	for (std::size_t i = 0; i < count; ++i) {
+		int column = get_column(x[i]);
+		int row = get_row(y[i]);
+		if (column < 0 || column >= m_columns || row < 0 || row >= m_rows) {
+			point_cells[i] = -1;
+			m_overflow.push_back(Item{ x[i], y[i], i });
+			continue;
+		}
+		int cell = row * m_columns + column;
+		point_cells[i] = cell;
+		++m_cell_starts[cell + 1];
+		++grid_count;
+	}
+
+	for (std::size_t cell = 0; cell < cell_count; ++cell) {
+		m_cell_starts[cell + 1] += m_cell_starts[cell];
+	}
+
+	// Scatter, m_cell_starts[cell] is used as the insert position and ends up at the start of the next cell
+	m_items.resize(grid_count);
+	for (std::size_t i = 0; i < count; ++i) {
+		int cell = point_cells[i];
+		if (cell >= 0) {
+			m_items[m_cell_starts[cell]++] = Item{ x[i], y[i], i };
+		}
+	}
+
+	// Shift the starts back
+	for (std::size_t cell = cell_count; cell > 0; --cell) {
+		m_cell_starts[cell] = m_cell_starts[cell - 1];
+	}
+	m_cell_starts[0] = 0;
+}
+
+SpatialGrid make_world_grid(float cell_size)
+{
+	Vector2 min(0.f, 0.f);
+	Vector2 max(1.f, 1.f);
+	scene::unitToWorld(&min.x, &min.y);
+	scene::unitToWorld(&max.x, &max.y);
+	return SpatialGrid(min, max, cell_size, true);
+}
+
+std::size_t SpatialGrid::find_nearest(const Vector2 & position, float max_distance) const
+{
+	std::size_t nearest = NO_ITEM;
+	float nearest_distance_squared = max_distance * max_distance;
+	auto visit = [&](const Item & item) {
+		float dx = item.x - position.x;
+		float dy = item.y - position.y;
+		float distance_squared = dx * dx + dy * dy;
+		if (distance_squared <= nearest_distance_squared) {
+			nearest_distance_squared = distance_squared;
+			nearest = item.index;
+		}
+	};
+
+	for (const Item & item : m_overflow) {
+		visit(item);
+	}
+
+	/*
+	 * Search rings of cells around the cell of the position, clamped into the grid
+	 * Clamping the position into the grid never increases its distance to grid points, and points
+	 * of ring r and further are at least r - 1 cells away from the clamped position
+	 */
+	int center_column = std::min(std::max(get_column(position.x), 0), m_columns - 1);
+	int center_row = std::min(std::max(get_row(position.y), 0), m_rows - 1);
+	int max_ring = std::max(std::max(center_column, m_columns - 1 - center_column), std::max(center_row, m_rows - 1 - center_row));
+
+	auto visit_cell = [&](int column, int row) {
+		if (column < 0 || column >= m_columns || row < 0 || row >= m_rows) {
+			return;
+		}
+		int cell = row * m_columns + column;
+		for (std::uint32_t i = m_cell_starts[cell]; i < m_cell_starts[cell + 1]; ++i) {
+			visit(m_items[i]);
+		}
+	};
+
+	for (int ring = 0; ring <= max_ring; ++ring) {
+		float ring_distance = (ring - 1) * m_cell_size;
+		if (ring > 1 && ring_distance * ring_distance > nearest_distance_squared) {
+			break;
+		}
+
+		if (ring == 0) {
+			visit_cell(center_column, center_row);
+			continue;
+		}
+
+		for (int column = center_column - ring; column <= center_column + ring; ++column) {
+			visit_cell(column, center_row - ring);
+			visit_cell(column, center_row + ring);
+		}
+		for (int row = center_row - ring + 1; row <= center_row + ring - 1; ++row) {
+			visit_cell(center_column - ring, row);
+			visit_cell(center_column + ring, row);
+		}
+	}
+
+	return nearest;
+}
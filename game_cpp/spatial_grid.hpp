@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "vector2.hpp"
+
+
+/*
+ * Uniform grid for proximity queries over points given as parallel x/y arrays
+ * The grid is rebuilt from scratch by build() (a counting sort by cell, linear in the number of points),
+ * queries return indices into the arrays passed to the last build()
+ *
+ * The grid covers the given bounds. A growing grid extends them on build() to cover all points, in whole
+ * cells and up to MAX_CELLS. Points left outside go to an overflow list, which every query checks as well,
+ * so queries are always exact, only slower when many points are outside
+ * A growing grid reserves MAX_CELLS up front, growing never allocates; build scratch is frame memory
+ */
+class SpatialGrid
+{
+public:
+	static constexpr std::size_t NO_ITEM = ~std::size_t(0);
+	static constexpr std::size_t MAX_CELLS = 1 << 16;
+
+	SpatialGrid(const Vector2 & min, const Vector2 & max, float cell_size, bool can_grow);
+
+	// Capacity for count points, builds with up to count points don't allocate
+	void reserve(std::size_t count);
+
+	void build(const float * x, const float * y, std::size_t count);
+
+	std::size_t size() const { return m_items.size() + m_overflow.size(); }
+
+	// Calls function(index, distance_squared) for every point within radius from center, in no particular order
+	template <class Function>
+	void for_each_within(const Vector2 & center, float radius, Function && function) const;
+
+	// Returns the index of the point closest to position within max_distance, or NO_ITEM
+	std::size_t find_nearest(const Vector2 & position, float max_distance) const;
+
+private:
+	struct Item
+	{
+		float x;
+		float y;
+		std::size_t index;
+	};
+
+	void resize(const Vector2 & min, const Vector2 & max);
+	int get_column(float x) const;
+	int get_row(float y) const;
+
+	Vector2 m_initial_min;
+	Vector2 m_initial_max;
+	Vector2 m_min;
+	float m_cell_size;
+	float m_inverse_cell_size;
+	bool m_can_grow;
+
+	int m_columns = 0;
+	int m_rows = 0;
+
+	// Items sorted by cell, m_cell_starts[cell] .. m_cell_starts[cell + 1] is the range of one cell
+	std::vector<std::uint32_t> m_cell_starts;
+	std::vector<Item> m_items;
+	std::vector<Item> m_overflow;
+};
+
+// Grid over the visible world area, growing past it when points leave the screen
+SpatialGrid make_world_grid(float cell_size);
+
+template <class Function>
+void SpatialGrid::for_each_within(const Vector2 & center, float radius, Function && function) const
+{
+	const float radius_squared = radius * radius;
+	auto visit = [&](const Item & item) {
+		float dx = item.x - center.x;
+		float dy = item.y - center.y;
+		float distance_squared = dx * dx + dy * dy;
+		if (distance_squared <= radius_squared) {
+			function(item.index, distance_squared);
+		}
+	};
+
+	for (const Item & item : m_overflow) {
+		visit(item);
+	}
+
+	int first_column = get_column(center.x - radius);
+	int last_column = get_column(center.x + radius);
+	int first_row = get_row(center.y - radius);
+	int last_row = get_row(center.y + radius);
+	if (last_column < 0 || first_column >= m_columns || last_row < 0 || first_row >= m_rows) {
+		return;
+	}
+
+	first_column = first_column < 0 ? 0 : first_column;
+	last_column = last_column >= m_columns ? m_columns - 1 : last_column;
+	first_row = first_row < 0 ? 0 : first_row;
+	last_row = last_row >= m_rows ? m_rows - 1 : last_row;
+
+	for (int row = first_row; row <= last_row; ++row) {
+		// Cells of one row are consecutive, so the whole column range is one range of items
+		std::uint32_t begin = m_cell_starts[row * m_columns + first_column];
+		std::uint32_t end = m_cell_starts[row * m_columns + last_column + 1];
+		for (std::uint32_t i = begin; i < end; ++i) {
+			visit(m_items[i]);
+		}
+	}
+}
@@ -0,0 +1,500 @@
+
+#define _USE_MATH_DEFINES
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+#include "params.hpp"
+#include "steering_kernels.hpp"
+#include "vector2.hpp"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define STEERING_X86
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define STEERING_NEON
+#include <arm_neon.h>
+#endif
+
+// AVX code is compiled without global compiler flags, the CPU support is checked at runtime
+#if defined(__clang__)
+#define STEERING_BEGIN_AVX _Pragma("clang attribute push (__attribute__((target(\"avx\"))), apply_to = function)")
+#define STEERING_END_AVX _Pragma("clang attribute pop")
+#elif defined(__GNUC__)
+#define STEERING_BEGIN_AVX _Pragma("GCC push_options") _Pragma("GCC target(\"avx\")")
+#define STEERING_END_AVX _Pragma("GCC pop_options")
+#else
+#define STEERING_BEGIN_AVX
+#define STEERING_END_AVX
+#endif
+
+
+//-------------------------------------------------------
+//	Reference kernels, based on Vector2
+//-------------------------------------------------------
+
+namespace scalar
+{
+	Vector2 correct_closing_to_target(const SteeringParams & steering, const Vector2 & destination, const Vector2 & linear_velocity)
+	{
+		if (destination.get_length() <= steering.landing_radius) {
+			// get projection of current velcity to target vector
+			float projection = (Vector2::dot(linear_velocity, destination) * linear_velocity).get_length();
+
+			if (projection > steering.landing_speed) {
+				return -destination;
+			}
+		}
+		return destination;
+	}
+
+	void orbit(const SteeringParams & steering, const SteeringBatch & batch, float * destination_x, float * destination_y)
+	{
+		for (std::size_t i = 0; i < batch.count; ++i) {
+			Vector2 goal_position(batch.goal_x[i], batch.goal_y[i]);
+			Vector2 position(batch.position_x[i], batch.position_y[i]);
+
+			// Vector to goal
+			Vector2 target_vector = goal_position - position;
+
+			/*
+			 * As we want to move around the target, we can move to the normal of the target vector
+			 * Target vector will be recalculated on each frame, so normal will be also recalculated
+			 * and aircraft will tries to moving to the circle
+			 * The normal is the target vector rotated by 90 degrees, which needs no trigonometry
+			 */
+			Vector2 target_normal(-target_vector.y, target_vector.x);
+			Vector2 orbit_position = goal_position + steering.target_radius * target_normal.get_normalized();
+
+			Vector2 destination = orbit_position - position;
+			destination_x[i] = destination.x;
+			destination_y[i] = destination.y;
+		}
+	}
+
+	float calculate_rotation(const SteeringParams & steering, const Vector2 & normalized_velocity, const Vector2 & destination)
+	{
+		float target_angle = Vector2::angle_rad(destination, normalized_velocity);
+		if (target_angle > 0) {
+			float rotation = steering.max_rotation;
+
+			return std::min(rotation, target_angle);
+		}
+		else {
+			float rotation = -steering.max_rotation;
+
+			return std::max(rotation, target_angle);
+		}
+	}
+
+	void steer(const SteeringParams & steering, const SteeringBatch & batch)
+	{
+		for (std::size_t i = 0; i < batch.count; ++i) {
+			if (batch.steering_mask[i] == 0.f) {
+				continue;
+			}
+
+			Vector2 linear_velocity(batch.velocity_x[i], batch.velocity_y[i]);
+			Vector2 destination = correct_closing_to_target(steering, Vector2(batch.destination_x[i], batch.destination_y[i]), linear_velocity);
+
+			/*
+			 * We need to elimenate non-helpfull velocity
+			 * We also want to achieve maximum speed for the destination vector
+			 */
+			destination = steering.linear_speed * destination.get_normalized() - linear_velocity;
+
+			Vector2 heading(batch.heading_x[i], batch.heading_y[i]);
+			float angle = batch.angle[i] + calculate_rotation(steering, heading, destination);
+			batch.angle[i] = angle;
+			batch.heading_x[i] = std::cos(angle);
+			batch.heading_y[i] = std::sin(angle);
+		}
+	}
+
+	void integrate(const SteeringParams & steering, const SteeringBatch & batch)
+	{
+		for (std::size_t i = 0; i < batch.count; ++i) {
+			Vector2 normalized_velocity(batch.heading_x[i], batch.heading_y[i]);
+			Vector2 velocity = Vector2(batch.velocity_x[i], batch.velocity_y[i]) + steering.acceleration * normalized_velocity;
+
+			if (velocity.get_length() > steering.linear_speed) {
+				velocity = steering.linear_speed * velocity.get_normalized();
+			}
+
+			Vector2 position = Vector2(batch.position_x[i], batch.position_y[i]) + steering.dt * velocity;
+
+			batch.velocity_x[i] = velocity.x;
+			batch.velocity_y[i] = velocity.y;
+			batch.position_x[i] = position.x;
+			batch.position_y[i] = position.y;
+		}
+	}
+}
+
+
+//-------------------------------------------------------
+//	Single lane pack, used for the tails of vectorized kernels
+//-------------------------------------------------------
+
+namespace lane
+{
+	struct Float1
+	{
+		static constexpr int WIDTH = 1;
+
+		float v;
+
+		Float1() = default;
+		explicit Float1(float value) : v(value) {}
+
+		static Float1 load(const float * p) { return Float1(*p); }
+		void store(float * p) const { *p = v; }
+	};
+
+	typedef Float1 F;
+	typedef bool M;
+
+	inline F operator + (F a, F b) { return F(a.v + b.v); }
+	inline F operator - (F a, F b) { return F(a.v - b.v); }
+	inline F operator * (F a, F b) { return F(a.v * b.v); }
+	inline F operator / (F a, F b) { return F(a.v / b.v); }
+	inline F operator - (F a) { return F(-a.v); }
+	inline M operator < (F a, F b) { return a.v < b.v; }
+	inline M operator > (F a, F b) { return a.v > b.v; }
+	inline M operator <= (F a, F b) { return a.v <= b.v; }
+	inline M operator == (F a, F b) { return a.v == b.v; }
+	inline F abs(F a) { return F(std::fabs(a.v)); }
+	inline F min(F a, F b) { return F(b.v < a.v ? b.v : a.v); }
+	inline F max(F a, F b) { return F(a.v < b.v ? b.v : a.v); }
+	inline F sqrt(F a) { return F(std::sqrt(a.v)); }
+	inline F select(M mask, F a, F b) { return mask ? a : b; }
+
+	#include "steering_kernels.inl"
+}
+
+
+//-------------------------------------------------------
+//	Generic loop over full packs and the tail
+//-------------------------------------------------------
+
+#define STEERING_DEFINE_KERNELS																\
+	void orbit(const SteeringParams & steering, const SteeringBatch & batch,				\
+		float * destination_x, float * destination_y)										\
+	{																						\
+		std::size_t i = 0;																	\
+		for (; i + F::WIDTH <= batch.count; i += F::WIDTH)									\
+			orbit_block(steering, batch, destination_x, destination_y, i);					\
+		for (; i < batch.count; ++i)														\
+			lane::orbit_block(steering, batch, destination_x, destination_y, i);			\
+	}																						\
+																							\
+	void steer(const SteeringParams & steering, const SteeringBatch & batch)				\
+	{																						\
+		std::size_t i = 0;																	\
+		for (; i + F::WIDTH <= batch.count; i += F::WIDTH)									\
+			steer_block(steering, batch, i);												\
+		for (; i < batch.count; ++i)														\
+			lane::steer_block(steering, batch, i);											\
+	}																						\
+																							\
+	void integrate(const SteeringParams & steering, const SteeringBatch & batch)			\
+	{																						\
+		std::size_t i = 0;																	\
+		for (; i + F::WIDTH <= batch.count; i += F::WIDTH)									\
+			integrate_block(steering, batch, i);											\
+		for (; i < batch.count; ++i)														\
+			lane::integrate_block(steering, batch, i);										\
+	}
+
+
+//-------------------------------------------------------
+//	SSE2 kernels
+//-------------------------------------------------------
+
+#if defined(STEERING_X86)
+namespace sse
+{
+	struct Float4
+	{
+		static constexpr int WIDTH = 4;
+
+		__m128 v;
+
+		Float4() = default;
+		Float4(__m128 value) : v(value) {}
+		explicit Float4(float value) : v(_mm_set1_ps(value)) {}
+
+		static Float4 load(const float * p) { return _mm_loadu_ps(p); }
+		void store(float * p) const { _mm_storeu_ps(p, v); }
+	};
+
+	struct Mask4
+	{
+		__m128 v;
+	};
+
+	typedef Float4 F;
+	typedef Mask4 M;
+
+	inline F operator + (F a, F b) { return _mm_add_ps(a.v, b.v); }
+	inline F operator - (F a, F b) { return _mm_sub_ps(a.v, b.v); }
+	inline F operator * (F a, F b) { return _mm_mul_ps(a.v, b.v); }
+	inline F operator / (F a, F b) { return _mm_div_ps(a.v, b.v); }
+	inline F operator - (F a) { return _mm_xor_ps(a.v, _mm_set1_ps(-0.f)); }
+	inline M operator < (F a, F b) { return M{ _mm_cmplt_ps(a.v, b.v) }; }
+	inline M operator > (F a, F b) { return M{ _mm_cmpgt_ps(a.v, b.v) }; }
+	inline M operator <= (F a, F b) { return M{ _mm_cmple_ps(a.v, b.v) }; }
+	inline M operator == (F a, F b) { return M{ _mm_cmpeq_ps(a.v, b.v) }; }
+	inline M operator & (M a, M b) { return M{ _mm_and_ps(a.v, b.v) }; }
+	inline M operator | (M a, M b) { return M{ _mm_or_ps(a.v, b.v) }; }
+	inline F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a.v); }
+	inline F min(F a, F b) { return _mm_min_ps(a.v, b.v); }
+	inline F max(F a, F b) { return _mm_max_ps(a.v, b.v); }
+	inline F sqrt(F a) { return _mm_sqrt_ps(a.v); }
+	inline F select(M mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)); }
+
+	#include "steering_kernels.inl"
+
+	STEERING_DEFINE_KERNELS
+}
+
+
+//-------------------------------------------------------
+//	AVX kernels
+//-------------------------------------------------------
+
+STEERING_BEGIN_AVX
+namespace avx
+{
+	struct Float8
+	{
+		static constexpr int WIDTH = 8;
+
+		__m256 v;
+
+		Float8() = default;
+		Float8(__m256 value) : v(value) {}
+		explicit Float8(float value) : v(_mm256_set1_ps(value)) {}
+
+		static Float8 load(const float * p) { return _mm256_loadu_ps(p); }
+		void store(float * p) const { _mm256_storeu_ps(p, v); }
+	};
+
+	struct Mask8
+	{
+		__m256 v;
+	};
+
+	typedef Float8 F;
+	typedef Mask8 M;
+
+	inline F operator + (F a, F b) { return _mm256_add_ps(a.v, b.v); }
+	inline F operator - (F a, F b) { return _mm256_sub_ps(a.v, b.v); }
+	inline F operator * (F a, F b) { return _mm256_mul_ps(a.v, b.v); }
+	inline F operator / (F a, F b) { return _mm256_div_ps(a.v, b.v); }
+	inline F operator - (F a) { return _mm256_xor_ps(a.v, _mm256_set1_ps(-0.f)); }
+	inline M operator < (F a, F b) { return M{ _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ) }; }
+	inline M operator > (F a, F b) { return M{ _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ) }; }
+	inline M operator <= (F a, F b) { return M{ _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ) }; }
+	inline M operator == (F a, F b) { return M{ _mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ) }; }
+	inline M operator & (M a, M b) { return M{ _mm256_and_ps(a.v, b.v) }; }
+	inline M operator | (M a, M b) { return M{ _mm256_or_ps(a.v, b.v) }; }
+	inline F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v); }
+	inline F min(F a, F b) { return _mm256_min_ps(a.v, b.v); }
+	inline F max(F a, F b) { return _mm256_max_ps(a.v, b.v); }
+	inline F sqrt(F a) { return _mm256_sqrt_ps(a.v); }
+	inline F select(M mask, F a, F b) { return _mm256_blendv_ps(b.v, a.v, mask.v); }
+
+	#include "steering_kernels.inl"
+
+	STEERING_DEFINE_KERNELS
+}
+STEERING_END_AVX
+#endif
+
+
+//-------------------------------------------------------
+//	NEON kernels
+//-------------------------------------------------------
+
+#if defined(STEERING_NEON)
+namespace neon
+{
+	struct Float4
+	{
+		static constexpr int WIDTH = 4;
+
+		float32x4_t v;
+
+		Float4() = default;
+		Float4(float32x4_t value) : v(value) {}
+		explicit Float4(float value) : v(vdupq_n_f32(value)) {}
+
+		static Float4 load(const float * p) { return vld1q_f32(p); }
+		void store(float * p) const { vst1q_f32(p, v); }
+	};
+
+	struct Mask4
+	{
+		uint32x4_t v;
+	};
+
+	typedef Float4 F;
+	typedef Mask4 M;
+
+	inline F operator + (F a, F b) { return vaddq_f32(a.v, b.v); }
+	inline F operator - (F a, F b) { return vsubq_f32(a.v, b.v); }
+	inline F operator * (F a, F b) { return vmulq_f32(a.v, b.v); }
+	inline F operator / (F a, F b) { return vdivq_f32(a.v, b.v); }
+	inline F operator - (F a) { return vnegq_f32(a.v); }
+	inline M operator < (F a, F b) { return M{ vcltq_f32(a.v, b.v) }; }
+	inline M operator > (F a, F b) { return M{ vcgtq_f32(a.v, b.v) }; }
+	inline M operator <= (F a, F b) { return M{ vcleq_f32(a.v, b.v) }; }
+	inline M operator == (F a, F b) { return M{ vceqq_f32(a.v, b.v) }; }
+	inline M operator & (M a, M b) { return M{ vandq_u32(a.v, b.v) }; }
+	inline M operator | (M a, M b) { return M{ vorrq_u32(a.v, b.v) }; }
+	inline F abs(F a) { return vabsq_f32(a.v); }
+	inline F min(F a, F b) { return vminq_f32(a.v, b.v); }
+	inline F max(F a, F b) { return vmaxq_f32(a.v, b.v); }
+	inline F sqrt(F a) { return vsqrtq_f32(a.v); }
+	inline F select(M mask, F a, F b) { return vbslq_f32(mask.v, a.v, b.v); }
+
+	#include "steering_kernels.inl"
+
+	STEERING_DEFINE_KERNELS
+}
+#endif
+
+
+//-------------------------------------------------------
+//	Cached orbit destinations
+//-------------------------------------------------------
+
+std::size_t orbit_cached(const SteeringParams & steering, const SteeringBatch & batch, const OrbitCache & cache,
+	float * destination_x, float * destination_y)
+{
+	std::size_t cached_count = 0;
+	for (std::size_t i = 0; i < batch.count; ++i) {
+		const float goal_x = batch.goal_x[i];
+		const float goal_y = batch.goal_y[i];
+		const float position_x = batch.position_x[i];
+		const float position_y = batch.position_y[i];
+
+		std::uint8_t state = cache.state[i];
+		if (goal_x != cache.goal_x[i] || goal_y != cache.goal_y[i]) {
+			cache.goal_x[i] = goal_x;
+			cache.goal_y[i] = goal_y;
+			state = ORBIT_CACHE_COLD;
+		}
+
+		float normal_x;
+		float normal_y;
+		if (state > ORBIT_CACHE_MEASURE) {
+			normal_x = cache.step_cos[i] * cache.normal_x[i] - cache.step_sin[i] * cache.normal_y[i];
+			normal_y = cache.step_sin[i] * cache.normal_x[i] + cache.step_cos[i] * cache.normal_y[i];
+			state = state == ORBIT_CACHE_MEASURE + 1 ? ORBIT_CACHE_COLD : static_cast<std::uint8_t>(state - 1);
+			++cached_count;
+		}
+		else {
+			const float target_x = goal_x - position_x;
+			const float target_y = goal_y - position_y;
+			const float inverse_length = 1.f / std::sqrt(target_x * target_x + target_y * target_y);
+			normal_x = -target_y * inverse_length;
+			normal_y = target_x * inverse_length;
+
+			// The last normal was exact too, the rotation between them is the step of this update
+			if (state == ORBIT_CACHE_MEASURE) {
+				const float step_cos = cache.normal_x[i] * normal_x + cache.normal_y[i] * normal_y;
+				const float step_sin = cache.normal_x[i] * normal_y - cache.normal_y[i] * normal_x;
+				const bool stable = std::abs(step_cos - cache.step_cos[i]) + std::abs(step_sin - cache.step_sin[i]) < ORBIT_CACHE_STABILITY;
+				cache.step_cos[i] = step_cos;
+				cache.step_sin[i] = step_sin;
+				state = stable ? static_cast<std::uint8_t>(ORBIT_CACHE_MEASURE + ORBIT_CACHE_INTERVAL) : ORBIT_CACHE_MEASURE;
+			}
+			else {
+				state = ORBIT_CACHE_MEASURE;
+			}
+		}
+
+		cache.normal_x[i] = normal_x;
+		cache.normal_y[i] = normal_y;
+		cache.state[i] = state;
+		destination_x[i] = goal_x + steering.target_radius * normal_x - position_x;
+		destination_y[i] = goal_y + steering.target_radius * normal_y - position_y;
+	}
+	return cached_count;
+}
+
+
+//-------------------------------------------------------
+//	Runtime selection
+//-------------------------------------------------------
+
+namespace
+{
+	const SteeringKernels s_all_kernels[] = {
+#if defined(STEERING_X86)
+		{ "avx", 8, &avx::orbit, &avx::steer, &avx::integrate },
+		{ "sse", 4, &sse::orbit, &sse::steer, &sse::integrate },
+#endif
+#if defined(STEERING_NEON)
+		{ "neon", 4, &neon::orbit, &neon::steer, &neon::integrate },
+#endif
+		{ "scalar", 1, &scalar::orbit, &scalar::steer, &scalar::integrate },
+	};
+
+	// Read by every fleet update chunk on the job threads, a forced selection may be stored while they run
+	std::atomic<const SteeringKernels *> s_selected_kernels{nullptr};
+
+	bool is_supported(const SteeringKernels & kernels)
+	{
+#if defined(STEERING_X86)
+		if (std::strcmp(kernels.name, "avx") == 0) {
+#if defined(_MSC_VER)
+			int info[4];
+			__cpuid(info, 1);
+			bool os_saves_ymm = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6;
+			return os_saves_ymm && (info[2] & (1 << 28)) != 0;
+#else
+			return __builtin_cpu_supports("avx");
+#endif
+		}
+#endif
+		// SSE2 is a baseline of all supported x86 targets, NEON of AArch64
+		return true;
+	}
+
+	const SteeringKernels & detect_steering_kernels()
+	{
+		for (const SteeringKernels & kernels : s_all_kernels) {
+			if (is_supported(kernels))
+				return kernels;
+		}
+		// The scalar kernels are last and always supported
+		return *(std::end(s_all_kernels) - 1);
+	}
+}
+
+const SteeringKernels & get_steering_kernels()
+{
+	// The detection runs once under the guard of the local static, concurrent first calls wait for it
+	static const SteeringKernels & s_detected_kernels = detect_steering_kernels();
+	const SteeringKernels * selected = s_selected_kernels.load(std::memory_order_acquire);
+	return selected ? *selected : s_detected_kernels;
+}
+
+bool select_steering_kernels(const char * name)
+{
+	for (const SteeringKernels & kernels : s_all_kernels) {
+		if (std::strcmp(kernels.name, name) == 0 && is_supported(kernels)) {
+			s_selected_kernels.store(&kernels, std::memory_order_release);
+			return true;
+		}
+	}
+	return false;
+}
@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+
+/*
+ * Batch kernels for the per-frame aircraft steering math over structure-of-arrays data
+ *
+ * "scalar" kernels are the reference: they use the Vector2 class exactly like the original per-aircraft code
+ * Vectorized kernels (sse, avx, neon) process 4 or 8 aircrafts per instruction and replace
+ * std::atan2 with a polynomial approximation
+ *
+ * Every aircraft keeps its heading as a unit vector next to the angle, so no kernel needs sin and cos
+ * of the angle: the reference recomputes the heading from the new angle, vectorized kernels rotate it
+ * incrementally, by the precomputed rotation_cos/rotation_sin at the full turn rate or straight onto the
+ * target direction, and renormalize it with a Newton step
+ *
+ * Tolerance against the reference for a single kernel call:
+ * - orbit destination: relative error below STEERING_RELATIVE_TOLERANCE
+ * - rotation: absolute error below STEERING_ROTATION_TOLERANCE, plus the rounding of the accumulated
+ *   angle itself (one ulp, angles are not wrapped)
+ * - velocity and position: relative error below STEERING_RELATIVE_TOLERANCE
+ * - heading: absolute error below STEERING_ROTATION_TOLERANCE against (cos(angle), sin(angle))
+ * Measured errors are about 5e-7 rad and 1.2e-7, the constants leave a margin for FMA contraction
+ * Simulation is chaotic near the landing and orbit switches, so trajectories of different kernels
+ * drift apart over many frames: compare kernels per call, not per run
+ */
+
+constexpr float STEERING_ROTATION_TOLERANCE = 2e-6f;
+constexpr float STEERING_RELATIVE_TOLERANCE = 1e-6f;
+
+struct SteeringParams
+{
+	float linear_speed;
+	float landing_radius;
+	float landing_speed;
+
+	// Per-frame limits, ANGULAR_SPEED * dt and LINEAR_ACCELERATION * dt
+	float max_rotation;
+	float acceleration;
+
+	// cos(max_rotation) and sin(max_rotation), the heading rotation of a turn at the full rate
+	float rotation_cos;
+	float rotation_sin;
+
+	float dt;
+
+	// Patrol orbit radius, TARGET_RADIUS of the class
+	float target_radius;
+};
+
+struct SteeringBatch
+{
+	std::size_t count;
+
+	// Uncorrected vector to the destination point, as returned by landing or target destination
+	const float * destination_x;
+	const float * destination_y;
+
+	// 1 for aircrafts, which steer to the destination, 0 for ones, which are still on the runway
+	const float * steering_mask;
+
+	// Goal of every aircraft, read by orbit only
+	const float * goal_x;
+	const float * goal_y;
+
+	float * angle;
+	float * heading_x;	// unit heading vector, (cos(angle), sin(angle))
+	float * heading_y;
+	float * velocity_x;
+	float * velocity_y;
+	float * position_x;
+	float * position_y;
+};
+
+struct SteeringKernels
+{
+	const char * name;
+	int width;
+
+	// Writes destinations of patrolling aircrafts: the orbit point around the goal a quarter turn ahead of the aircraft (position)
+	void (*orbit)(const SteeringParams & steering, const SteeringBatch & batch, float * destination_x, float * destination_y);
+
+	// Corrects destinations and rotates steering aircrafts towards them (angle, heading)
+	void (*steer)(const SteeringParams & steering, const SteeringBatch & batch);
+
+	// Accelerates along the heading, clamps to the maximum speed and moves (velocity, position)
+	void (*integrate)(const SteeringParams & steering, const SteeringBatch & batch);
+};
+
+// The forced kernels, otherwise the best ones supported by the CPU, detected on the first call. Safe to call from any thread
+const SteeringKernels & get_steering_kernels();
+
+// Forces kernels by name ("scalar", "sse", "avx", "neon"), returns false if they are not supported
+bool select_steering_kernels(const char * name);
+
+/*
+ * Incremental alternative to the orbit kernel for aircrafts, which fly a steady orbit around an unchanged goal
+ *
+ * The orbit point is the goal plus target_radius times the unit normal of the vector to the goal. An aircraft
+ * on a steady orbit turns that normal by about the same angle every update, so the cache keeps the normal and
+ * its rotation step per aircraft: a cached update rotates the normal by the step, without a square root and
+ * a division. The step is measured between the exact normals of two consecutive updates and trusted when it
+ * agrees with the previous measurement within ORBIT_CACHE_STABILITY. After ORBIT_CACHE_INTERVAL cached updates
+ * an aircraft re-syncs with two exact ones, which bounds the drift to that many steps
+ * A moved or reassigned goal (any change of the goal position) drops the cache of the aircraft at once
+ *
+ * The cache is scalar only and the fleet doesn't use it: the vectorized orbit kernel is cheaper than the branches
+ * and the extra arrays, see the steering/steady_orbit/cached benchmark
+ */
+constexpr int ORBIT_CACHE_INTERVAL = 8;
+constexpr float ORBIT_CACHE_STABILITY = 2e-5f;
+
+// Cache states: no normal yet, the last normal is exact, otherwise 1 + the number of cached updates left
+constexpr std::uint8_t ORBIT_CACHE_COLD = 0;
+constexpr std::uint8_t ORBIT_CACHE_MEASURE = 1;
+
+struct OrbitCache
+{
+	float * normal_x;	// unit normal of the last update
+	float * normal_y;
+	float * step_cos;	// rotation of the normal per update
+	float * step_sin;
+	float * goal_x;	// goal the normal belongs to
+	float * goal_y;
+	std::uint8_t * state;
+};
+
+// Writes the orbit destinations of the batch like SteeringKernels::orbit and advances the cache,
+// returns the number of aircrafts, which were updated from the cache
+std::size_t orbit_cached(const SteeringParams & steering, const SteeringBatch & batch, const OrbitCache & cache,
+	float * destination_x, float * destination_y);
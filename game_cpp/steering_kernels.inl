@@ -0,0 +1,113 @@
+/*
+ * Generic body of the vectorized steering kernels
+ * Included by steering_kernels.cpp once per instruction set, inside a namespace which defines
+ * the float pack F (WIDTH lanes) and its mask type M
+ * It's also included for the single lane pack, which handles the tail of the arrays with the same math
+ */
+
+inline F poly_atan2(F y, F x)
+{
+	F ax = abs(x);
+	F ay = abs(y);
+	F num = min(ax, ay);
+	F den = max(ax, ay);
+	F a = select(den > F(0.f), num / den, F(0.f));
+
+	// Reduce [tan(pi/8), 1] to [-tan(pi/8), tan(pi/8)]
+	M reduce = a > F(0.41421356f);
+	a = select(reduce, (a - F(1.f)) / (a + F(1.f)), a);
+
+	F z = a * a;
+	F r = (((F(8.05374449538e-2f) * z - F(1.38776856032e-1f)) * z + F(1.99777106478e-1f)) * z - F(3.33329491539e-1f)) * z * a + a;
+	r = select(reduce, r + F(0.78539816f), r);
+
+	r = select(ay > ax, F(1.57079633f) - r, r);
+	r = select(x < F(0.f), F(3.14159265f) - r, r);
+	return select(y < F(0.f), -r, r);
+}
+
+inline void orbit_block(const SteeringParams & steering, const SteeringBatch & batch, float * destination_x, float * destination_y, std::size_t i)
+{
+	F goal_x = F::load(batch.goal_x + i);
+	F goal_y = F::load(batch.goal_y + i);
+	F px = F::load(batch.position_x + i);
+	F py = F::load(batch.position_y + i);
+
+	// Orbit point: the goal plus the target vector normal (-ty, tx), scaled to the orbit radius
+	F tx = goal_x - px;
+	F ty = goal_y - py;
+	F scale = F(steering.target_radius) / sqrt(tx * tx + ty * ty);
+	(goal_x - scale * ty - px).store(destination_x + i);
+	(goal_y + scale * tx - py).store(destination_y + i);
+}
+
+inline void steer_block(const SteeringParams & steering, const SteeringBatch & batch, std::size_t i)
+{
+	F dx = F::load(batch.destination_x + i);
+	F dy = F::load(batch.destination_y + i);
+	F vx = F::load(batch.velocity_x + i);
+	F vy = F::load(batch.velocity_y + i);
+	F hx = F::load(batch.heading_x + i);
+	F hy = F::load(batch.heading_y + i);
+
+	// correct_closing_to_target: |dot(v, d) / |d|| is the projection of the velocity to the destination
+	F length = sqrt(dx * dx + dy * dy);
+	F projection = abs(vx * dx + vy * dy) / length;
+	M flip = (length <= F(steering.landing_radius)) & (projection > F(steering.landing_speed));
+	dx = select(flip, -dx, dx);
+	dy = select(flip, -dy, dy);
+
+	// Eliminate non-helpfull velocity and try to reach the maximum speed
+	F speed_scale = F(steering.linear_speed) / length;
+	F cx = speed_scale * dx - vx;
+	F cy = speed_scale * dy - vy;
+
+	// angle_rad(corrected, heading) doesn't need normalized vectors, atan2 is scale invariant
+	F target_angle = -poly_atan2(cx * hy - cy * hx, cx * hx + cy * hy);
+
+	F max_rotation(steering.max_rotation);
+	M turn_left = target_angle > F(0.f);
+	F rotation = select(turn_left, min(max_rotation, target_angle), max(-max_rotation, target_angle));
+	M steering_mask = F::load(batch.steering_mask + i) > F(0.5f);
+	rotation = select(steering_mask, rotation, F(0.f));
+	(F::load(batch.angle + i) + rotation).store(batch.angle + i);
+
+	// A turn at the full rate rotates the heading by the precomputed rotation, a shorter one ends on the target direction
+	F rotation_cos(steering.rotation_cos);
+	F rotation_sin = select(turn_left, F(steering.rotation_sin), F(-steering.rotation_sin));
+	F turned_x = rotation_cos * hx - rotation_sin * hy;
+	F turned_y = rotation_sin * hx + rotation_cos * hy;
+
+	F corrected_length = sqrt(cx * cx + cy * cy);
+	M has_direction = corrected_length > F(0.f);
+	F target_x = select(has_direction, cx / corrected_length, hx);
+	F target_y = select(has_direction, cy / corrected_length, hy);
+	M short_turn = abs(target_angle) < max_rotation;
+	turned_x = select(short_turn, target_x, turned_x);
+	turned_y = select(short_turn, target_y, turned_y);
+
+	// One Newton step for 1 / |heading| keeps the rotated vector unit length, errors don't accumulate
+	F scale = F(1.5f) - F(0.5f) * (turned_x * turned_x + turned_y * turned_y);
+	select(steering_mask, scale * turned_x, hx).store(batch.heading_x + i);
+	select(steering_mask, scale * turned_y, hy).store(batch.heading_y + i);
+}
+
+inline void integrate_block(const SteeringParams & steering, const SteeringBatch & batch, std::size_t i)
+{
+	F acceleration(steering.acceleration);
+	F vx = F::load(batch.velocity_x + i) + acceleration * F::load(batch.heading_x + i);
+	F vy = F::load(batch.velocity_y + i) + acceleration * F::load(batch.heading_y + i);
+
+	F linear_speed(steering.linear_speed);
+	F length = sqrt(vx * vx + vy * vy);
+	M too_fast = length > linear_speed;
+	F speed_scale = linear_speed / length;
+	vx = select(too_fast, speed_scale * vx, vx);
+	vy = select(too_fast, speed_scale * vy, vy);
+	vx.store(batch.velocity_x + i);
+	vy.store(batch.velocity_y + i);
+
+	F dt(steering.dt);
+	(F::load(batch.position_x + i) + dt * vx).store(batch.position_x + i);
+	(F::load(batch.position_y + i) + dt * vy).store(batch.position_y + i);
+}
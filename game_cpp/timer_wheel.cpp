@@ -0,0 +1,232 @@
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+#include "timer_wheel.hpp"
+
+
+constexpr std::uint32_t TimerWheel::NO_ENTRY;
+
+TimerWheel::TimerWheel(float tick_length) :
+	m_tick_length(tick_length)
+{
+	assert(tick_length > 0.f);
+	for (int level = 0; level < LEVEL_COUNT; ++level) {
+		m_levels[level].resize(get_mask(level) + 1, NO_ENTRY);
+	}
+}
+
+void TimerWheel::clear()
+{
+	for (auto & level : m_levels) {
+		std::fill(level.begin(), level.end(), NO_ENTRY);
+	}
+	m_overflow = NO_ENTRY;
+	m_entries.clear();
+	m_free = NO_ENTRY;
+	m_time = 0.0;
+	m_tick = 0;
+	m_sequence = 0;
+	m_size = 0;
+}
+
+void TimerWheel::reserve(std::size_t count)
+{
+	m_entries.reserve(count);
+	m_due.reserve(m_entries.capacity());
+}
+
+std::uint32_t & TimerWheel::get_slot(int level, std::uint64_t tick)
+{
+	return m_levels[level][(tick >> get_shift(level)) & get_mask(level)];
+}
+
+void TimerWheel::insert(std::uint32_t index)
+{
+	// Overdue events go to the current slot, which is checked again on the next advance
+	Entry & entry = m_entries[index];
+	std::uint64_t tick = std::max(entry.tick, m_tick);
+	std::uint64_t delta = tick - m_tick;
+	std::uint32_t * head = &m_overflow;
+	for (int level = 0; level < LEVEL_COUNT; ++level) {
+		if (delta < (std::uint64_t(1) << get_shift(level + 1))) {
+			head = &get_slot(level, tick);
+			break;
+		}
+	}
+	entry.next = *head;
+	*head = index;
+}
+
+void TimerWheel::schedule(float delay, TimerEventType type, std::uint32_t target, std::uint32_t generation, std::uint32_t group)
+{
+	std::uint32_t index = m_free;
+	if (index != NO_ENTRY) {
+		m_free = m_entries[index].next;
+	}
+	else {
+		index = static_cast<std::uint32_t>(m_entries.size());
+		m_entries.emplace_back();
+		// All pending events may become due at once
+		m_due.reserve(m_entries.capacity());
+	}
+
+	Entry & entry = m_entries[index];
+	entry.event = TimerEvent{ m_time + delay, type, target, generation, group };
+	entry.tick = static_cast<std::uint64_t>(std::floor(entry.event.time / m_tick_length));
+	entry.sequence = m_sequence++;
+	insert(index);
+	++m_size;
+}
+
+void TimerWheel::cascade(int level)
+{
+	// Events of the slot have ticks within the next turn of the level below, insert() moves them there
+	std::uint32_t & slot = level < LEVEL_COUNT ? get_slot(level, m_tick) : m_overflow;
+	std::uint32_t index = slot;
+	slot = NO_ENTRY;
+	while (index != NO_ENTRY) {
+		std::uint32_t next = m_entries[index].next;
+		insert(index);
+		index = next;
+	}
+}
+
+void TimerWheel::advance(float dt, std::vector<TimerEvent> & due)
+{
+	m_time += dt;
+	const std::uint64_t target_tick = static_cast<std::uint64_t>(std::floor(m_time / m_tick_length));
+
+	while (true) {
+		// The current slot holds the events of the current tick, the ones later than the time stay there
+		std::uint32_t * link = &get_slot(0, m_tick);
+		while (*link != NO_ENTRY) {
+			const std::uint32_t index = *link;
+			Entry & entry = m_entries[index];
+			if (entry.event.time <= m_time) {
+				m_due.push_back(entry);
+				*link = entry.next;
+				entry.next = m_free;
+				m_free = index;
+			}
+			else {
+				link = &entry.next;
+			}
+		}
+
+		if (m_tick >= target_tick) {
+			break;
+		}
+
+		// Entering a new tick: turns of the finer levels pull the next slot of the coarser ones, coarsest first
+		++m_tick;
+		int cascade_levels = 0;
+		while (cascade_levels < LEVEL_COUNT && (m_tick & ((std::uint64_t(1) << get_shift(cascade_levels + 1)) - 1)) == 0) {
+			++cascade_levels;
+		}
+		for (int level = cascade_levels; level > 0; --level) {
+			cascade(level);
+		}
+	}
+
+	std::sort(m_due.begin(), m_due.end(), [](const Entry & lhv, const Entry & rhv) {
+		return lhv.event.time < rhv.event.time || (lhv.event.time == rhv.event.time && lhv.sequence < rhv.sequence);
+	});
+	for (const Entry & entry : m_due) {
+		due.push_back(entry.event);
+	}
+	m_size -= m_due.size();
+	m_due.clear();
+}
+
+double TimerWheel::get_next_time() const
+{
+	double next = std::numeric_limits<double>::infinity();
+	auto scan = [this, &next](std::uint32_t index) {
+		for (; index != NO_ENTRY; index = m_entries[index].next) {
+			next = std::min(next, m_entries[index].event.time);
+		}
+	};
+	for (const auto & level : m_levels) {
+		for (std::uint32_t head : level) {
+			scan(head);
+		}
+	}
+	scan(m_overflow);
+	return next;
+}
+
+void TimerWheel::save(SnapshotWriter & snapshot) const
+{
+	snapshot.write(m_tick_length);
+	snapshot.write(m_time);
+	snapshot.write(m_tick);
+	snapshot.write(m_sequence);
+	snapshot.write(static_cast<std::uint64_t>(m_size));
+	snapshot.write_array(m_entries);
+	snapshot.write(m_free);
+	for (const auto & level : m_levels) {
+		snapshot.write_array(level);
+	}
+	snapshot.write(m_overflow);
+}
+
+bool TimerWheel::restore(SnapshotReader & snapshot)
+{
+	std::uint64_t size = 0;
+	snapshot.expect(m_tick_length);
+	snapshot.read(m_time);
+	snapshot.read(m_tick);
+	snapshot.read(m_sequence);
+	snapshot.read(size);
+	snapshot.read_array(m_entries);
+	snapshot.read(m_free);
+	for (int level = 0; level < LEVEL_COUNT; ++level) {
+		snapshot.read_array(m_levels[level]);
+		if (m_levels[level].size() != get_mask(level) + 1) {
+			m_levels[level].resize(get_mask(level) + 1);
+			clear();
+			return false;
+		}
+	}
+	snapshot.read(m_overflow);
+	m_size = static_cast<std::size_t>(size);
+	if (!snapshot.is_valid() || !std::isfinite(m_time) || !has_valid_lists()) {
+		clear();
+		return false;
+	}
+
+	m_due.reserve(m_entries.capacity());
+	return true;
+}
+
+bool TimerWheel::has_valid_lists() const
+{
+	// Every entry is on exactly one list, a slot, the overflow or the free one, so all links stay in the pool
+	// and no list runs in a cycle. The pending ones have to add up to the size
+	std::vector<bool> listed(m_entries.size(), false);
+	bool valid = true;
+	auto walk = [&](std::uint32_t index) {
+		std::size_t length = 0;
+		while (valid && index != NO_ENTRY) {
+			valid = index < m_entries.size() && !listed[index];
+			if (valid) {
+				listed[index] = true;
+				++length;
+				index = m_entries[index].next;
+			}
+		}
+		return length;
+	};
+
+	std::size_t pending = walk(m_overflow);
+	for (const auto & level : m_levels) {
+		for (std::uint32_t head : level) {
+			pending += walk(head);
+		}
+	}
+	const std::size_t free = walk(m_free);
+	return valid && pending == m_size && pending + free == m_entries.size();
+}
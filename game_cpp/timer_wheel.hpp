@@ -0,0 +1,133 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "snapshot.hpp"
+
+
+/*
+ * Game timer events, all lifecycle transitions are scheduled through one TimerWheel
+ * target is an aircraft id or a carrier index, generation tells apart reused aircraft ids
+ * and group is the aircraft class, which owns the id
+ */
+enum TimerEventType : std::uint32_t
+{
+	TIMER_AIRCRAFT_TAKEOFF,	// taxi -> patrol
+	TIMER_AIRCRAFT_RETURN,	// patrol -> landing
+	TIMER_CARRIER_REFILL,	// one more aircraft of the carrier is ready
+};
+
+struct TimerEvent
+{
+	double time;
+	TimerEventType type;
+	std::uint32_t target;
+	std::uint32_t generation;
+	std::uint32_t group;
+};
+
+/*
+ * Hierarchical timer wheel: three levels of 256, 64 and 64 slots, each slot of a level spans a whole
+ * turn of the level below. Events are kept in the slot of their tick and cascade down to finer levels
+ * as the time gets close, so scheduling is O(1) and advancing is O(1) per tick plus the due events
+ * Events further than the whole wheel wait in an overflow list, which is rescanned once per turn of the top level
+ *
+ * Time is kept exactly: an event fires on the first advance, after which time >= event time,
+ * the tick length only affects how events are bucketed
+ *
+ * Entries of all slots live in one pool, a slot is a list through it, so the wheel only allocates
+ * when more events are pending than ever before, or never after reserve() for as many
+ */
+class TimerWheel
+{
+public:
+	explicit TimerWheel(float tick_length);
+
+	// Drops all events and restarts the time from zero
+	void clear();
+
+	double get_time() const { return m_time; }
+	std::size_t size() const { return m_size; }
+
+	// Makes room for count pending events, advance() appends at most that many to its due list:
+	// reserve the list for get_capacity() events as well
+	void reserve(std::size_t count);
+	std::size_t get_capacity() const { return m_entries.capacity(); }
+
+	void schedule(float delay, TimerEventType type, std::uint32_t target, std::uint32_t generation = 0, std::uint32_t group = 0);
+
+	// Advances the time by dt and appends the due events to due, ordered by time and then by scheduling order
+	void advance(float dt, std::vector<TimerEvent> & due);
+
+	// Time of the earliest pending event, or infinity, scans all events: meant for debugging and tools
+	double get_next_time() const;
+
+	// Calls function(event) for every pending event in no particular order, scans all events:
+	// meant for checking a restored state against the event targets
+	template <class Function>
+	void for_each_event(Function && function) const;
+
+	// The whole wheel as is, pending events keep their order. A snapshot of a wheel with another tick
+	// length, or with lists, which don't hold every entry exactly once, is rejected, the wheel is left cleared then
+	void save(SnapshotWriter & snapshot) const;
+	bool restore(SnapshotReader & snapshot);
+
+private:
+	struct Entry
+	{
+		TimerEvent event;
+		std::uint64_t tick;
+		std::uint64_t sequence;
+		std::uint32_t next;	// in the slot or in the free list
+	};
+
+	static constexpr std::uint32_t NO_ENTRY = 0xffffffffu;
+
+	static constexpr int LEVEL0_BITS = 8;
+	static constexpr int LEVEL_BITS = 6;
+	static constexpr int LEVEL_COUNT = 3;
+	static constexpr std::uint64_t LEVEL0_SLOTS = 1u << LEVEL0_BITS;
+	static constexpr std::uint64_t LEVEL_SLOTS = 1u << LEVEL_BITS;
+
+	static int get_shift(int level) { return level == 0 ? 0 : LEVEL0_BITS + (level - 1) * LEVEL_BITS; }
+	static std::uint64_t get_mask(int level) { return (level == 0 ? LEVEL0_SLOTS : LEVEL_SLOTS) - 1; }
+
+	void insert(std::uint32_t index);
+	bool has_valid_lists() const;
+	void cascade(int level);
+	std::uint32_t & get_slot(int level, std::uint64_t tick);
+
+	double m_tick_length;
+	double m_time = 0.0;
+	std::uint64_t m_tick = 0;
+	std::uint64_t m_sequence = 0;
+	std::size_t m_size = 0;
+
+	std::vector<Entry> m_entries;
+	std::uint32_t m_free = NO_ENTRY;
+
+	// Heads of the slot lists
+	std::vector<std::uint32_t> m_levels[LEVEL_COUNT];
+	std::uint32_t m_overflow = NO_ENTRY;
+
+	// Scratch for sorting the due events, reserved along with the pool
+	std::vector<Entry> m_due;
+};
+
+template <class Function>
+void TimerWheel::for_each_event(Function && function) const
+{
+	auto scan = [this, &function](std::uint32_t index) {
+		for (; index != NO_ENTRY; index = m_entries[index].next) {
+			function(m_entries[index].event);
+		}
+	};
+	for (const auto & level : m_levels) {
+		for (std::uint32_t head : level) {
+			scan(head);
+		}
+	}
+	scan(m_overflow);
+}
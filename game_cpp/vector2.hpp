@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef _USE_MATH_DEFINES
+#define _USE_MATH_DEFINES
+#endif
+#include <cmath>
+
+
+//-------------------------------------------------------
+//	Basic Vector2 class
+//-------------------------------------------------------
+
+class Vector2
+{
+public:
+	float x;
+	float y;
+
+	Vector2();
+	Vector2( float vx, float vy );
+	Vector2( Vector2 const &other ) = default;
+
+	float get_length() const;
+	Vector2 get_normalized() const;
+	Vector2 get_rotated(float angle_rad) const;
+
+	static float dot(const Vector2 & lhv, const Vector2 & rhv);
+	static float angle_rad(const Vector2& lhv, const Vector2& rhv);
+};
+
+inline Vector2::Vector2() :
+	x( 0.f ),
+	y( 0.f )
+{
+}
+
+inline Vector2::Vector2( float vx, float vy ) :
+	x( vx ),
+	y( vy )
+{
+}
+
+inline float Vector2::get_length() const
+{
+	return std::sqrt(x * x + y * y);
+}
+
+inline Vector2 Vector2::get_normalized() const
+{
+	float length = get_length();
+	return Vector2(x / length, y / length);
+}
+
+inline float Vector2::dot(const Vector2& lhv, const Vector2& rhv)
+{
+	Vector2 normalized_lhv = lhv.get_normalized();
+	Vector2 normalized_rhv = rhv.get_normalized();
+	return normalized_lhv.x * normalized_rhv.x + normalized_lhv.y * normalized_rhv.y;
+}
+
+inline float Vector2::angle_rad(const Vector2& lhv, const Vector2& rhv)
+{
+	Vector2 normalized_lhv = lhv.get_normalized();
+	Vector2 normalized_rhv = rhv.get_normalized();
+	return -std::atan2(normalized_lhv.x * normalized_rhv.y - normalized_lhv.y * normalized_rhv.x, normalized_lhv.x * normalized_rhv.x + normalized_lhv.y * normalized_rhv.y);
+}
+
+inline Vector2 Vector2::get_rotated(float angle_rad) const
+{
+	return Vector2(std::cos(angle_rad) * x - std::sin(angle_rad) * y, std::sin(angle_rad) * x + std::cos(angle_rad) * y);
+}
+
+inline Vector2 operator + ( Vector2 const &left, Vector2 const &right )
+{
+	return Vector2( left.x + right.x, left.y + right.y );
+}
+
+inline Vector2 operator - (Vector2 const& left, Vector2 const& right)
+{
+	return Vector2(left.x - right.x, left.y - right.y);
+}
+
+inline Vector2 operator - (Vector2 const& left)
+{
+	return Vector2(-left.x, -left.y);
+}
+
+inline Vector2 operator * ( float left, Vector2 const &right )
+{
+	return Vector2( left * right.x, left * right.y );
+}